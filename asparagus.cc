@@ -0,0 +1,275 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "asparagus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "config.h"
+#include "controller.h"
+#include "engine.h"
+#include "network.h"
+#include "randoms.h"
+#include "weights.h"
+
+using namespace asparagus;
+
+static_assert(ASP_WIN_SCORE == kWinScore && ASP_MIN_WIN_SCORE == kMinWinScore, "scores are passed as they are");
+
+struct asp_engine {
+    struct Played {
+        Cell cell;
+        Stone stone;
+    };
+
+    asp_engine(const Config& engine_config, int board_width, int board_height)
+        :   config(engine_config),
+            width(board_width),
+            height(board_height),
+            engine(config),
+            controller(config, &engine),
+            is_over(false),
+            stop(false) {}
+
+    Config config;
+    int width;
+    int height;
+    Engine engine;
+    Controller controller;
+    // The moves on the board of the controller.
+    std::vector<Played> played;
+    bool is_over;
+    std::atomic<bool> stop;
+
+    void Restart() {
+        controller.Start(width, height);
+        played.clear();
+        is_over = false;
+    }
+};
+
+// The structs of version 1, callers never pass smaller ones.
+static constexpr uint32_t kMinOptionsSize = sizeof(asp_options);
+static constexpr uint32_t kMinLimitsSize = sizeof(asp_limits);
+static constexpr uint32_t kMinSearchInfoSize = sizeof(asp_search_info);
+
+// Copies the part of a struct both sides know, the rest of the destination is
+// left as it is.
+template <typename T>
+static void CopyStruct(T* to, uint32_t to_size, const T* from, uint32_t from_size) {
+    memcpy(to, from, std::min({ to_size, from_size, static_cast<uint32_t>(sizeof(T)) }));
+    to->struct_size = to_size;
+}
+
+static std::mutex randoms_mutex;
+static bool are_randoms_initialized = false;
+
+static void InitializeOnce() {
+    std::lock_guard<std::mutex> lock(randoms_mutex);
+    if (!are_randoms_initialized) {
+        InitializeRandoms();
+        are_randoms_initialized = true;
+    }
+}
+
+int asp_api_version(void) {
+    return ASP_API_VERSION;
+}
+
+asp_status asp_seed(uint64_t seed) {
+    // The boards of existing engines keep hashes of the old keys.
+    std::lock_guard<std::mutex> lock(randoms_mutex);
+    if (are_randoms_initialized) {
+        return ASP_INVALID_ARGUMENT;
+    }
+    InitializeRandoms(seed);
+    are_randoms_initialized = true;
+    return ASP_OK;
+}
+
+void asp_options_init(asp_options* options, uint32_t struct_size) {
+    if (struct_size < kMinOptionsSize) {
+        return;
+    }
+    const Config config;
+    asp_options defaults;
+    memset(&defaults, 0, sizeof(defaults));
+    defaults.width = 15;
+    defaults.height = 15;
+    defaults.is_exact_five = config.is_exact_five();
+    defaults.is_renju = config.is_renju();
+    defaults.cache_size_mb = config.Get("cache_size");
+    defaults.max_depth = config.max_depth();
+    defaults.time_limit_ms = config.time_limit();
+    defaults.max_nodes = config.max_nodes();
+    memset(options, 0, struct_size);
+    CopyStruct(options, struct_size, &defaults, sizeof(defaults));
+}
+
+void asp_limits_init(asp_limits* limits, uint32_t struct_size) {
+    if (struct_size < kMinLimitsSize) {
+        return;
+    }
+    memset(limits, 0, struct_size);
+    limits->struct_size = struct_size;
+}
+
+asp_engine* asp_engine_create(const asp_options* caller_options) {
+    if (!caller_options || caller_options->struct_size < kMinOptionsSize) {
+        return nullptr;
+    }
+    asp_options full_options;
+    asp_options_init(&full_options, sizeof(full_options));
+    CopyStruct(&full_options, sizeof(full_options), caller_options, caller_options->struct_size);
+    const asp_options* options = &full_options;
+    if (options->width < Board::kMinSize || options->width > Board::kMaxSize ||
+        options->height < Board::kMinSize || options->height > Board::kMaxSize ||
+        options->cache_size_mb < 0 || options->max_depth < 1 || options->time_limit_ms < 0 || options->max_nodes < 0) {
+        return nullptr;
+    }
+    InitializeOnce();
+    Config config;
+    config.Set("is_exact_five", options->is_exact_five);
+    config.Set("renju", options->is_renju);
+    config.Set("cache_size", options->cache_size_mb);
+    config.Set("max_depth", options->max_depth);
+    config.Set("time_limit", options->time_limit_ms);
+    config.Set("max_nodes", options->max_nodes);
+    if (options->weights_file && *options->weights_file) {
+        config.set_weights_file(options->weights_file);
+        if (!Weights::GetPatterns(config.weights_file())) {
+            return nullptr;
+        }
+    }
+    if (options->network_file && *options->network_file) {
+        config.set_network_file(options->network_file);
+        if (!Network::Get(config.network_file())) {
+            return nullptr;
+        }
+    }
+    asp_engine* engine = new asp_engine(config, options->width, options->height);
+    engine->Restart();
+    return engine;
+}
+
+void asp_engine_destroy(asp_engine* engine) {
+    delete engine;
+}
+
+asp_status asp_engine_set_position(asp_engine* engine, const asp_move* moves, int32_t count) {
+    if (!engine || count < 0 || (count && !moves)) {
+        return ASP_INVALID_ARGUMENT;
+    }
+    // The engine is to move after the last move, so the colours follow from
+    // the number of moves. The board is kept if the moves on it are a prefix
+    // of the new position in the same colours.
+    auto get_stone = [count](int32_t i) { return (count - i) % 2 ? kPlayer : kEngine; };
+    const Board& board = engine->controller.board();
+    size_t common = 0;
+    while (common < engine->played.size() && common < static_cast<size_t>(count) &&
+           engine->played[common].stone == get_stone(static_cast<int32_t>(common)) &&
+           engine->played[common].cell == MakeCell(moves[common].x + 1, moves[common].y + 1)) {
+        common += 1;
+    }
+    if (common < engine->played.size()) {
+        engine->Restart();
+        common = 0;
+    }
+    for (int32_t i = static_cast<int32_t>(common); i < count; i++) {
+        const asp_move& move = moves[i];
+        if (move.x < 0 || move.x >= board.width() || move.y < 0 || move.y >= board.height() ||
+            !board.IsEmptyCell(MakeCell(move.x + 1, move.y + 1))) {
+            engine->Restart();
+            return ASP_ILLEGAL_MOVE;
+        }
+        const Cell cell = MakeCell(move.x + 1, move.y + 1);
+        const Stone stone = get_stone(i);
+        if (board.IsTerminalMove(cell, stone, engine->config.is_exact_five())) {
+            engine->is_over = true;
+        }
+        engine->controller.SetCell(cell, stone);
+        engine->played.push_back({ cell, stone });
+    }
+    return ASP_OK;
+}
+
+// Searches with the structs of this version.
+static asp_status Search(asp_engine* engine, const asp_limits* limits, asp_search_info* info) {
+    info->move = { -1, -1 };
+    if (engine->is_over) {
+        return ASP_GAME_OVER;
+    }
+    const int max_depth = engine->config.max_depth();
+    const int time_limit = engine->config.time_limit();
+    const int max_nodes = engine->config.max_nodes();
+    if (limits && limits->max_depth > 0) {
+        engine->config.Set("max_depth", limits->max_depth);
+    }
+    if (limits && limits->time_limit_ms > 0) {
+        engine->config.Set("time_limit", limits->time_limit_ms);
+    }
+    if (limits && limits->max_nodes > 0) {
+        engine->config.Set("max_nodes", limits->max_nodes);
+    }
+    engine->stop.store(false);
+    SearchControl control;
+    control.stop = &engine->stop;
+    const Cell move = engine->controller.GetEngineMove(&control);
+    engine->config.Set("max_depth", max_depth);
+    engine->config.Set("time_limit", time_limit);
+    engine->config.Set("max_nodes", max_nodes);
+
+    const SearchInfo& last_info = engine->engine.last_info();
+    info->depth = last_info.depth;
+    info->score = last_info.score;
+    info->nodes = last_info.nodes;
+    info->time_s = last_info.time;
+    for (Cell cell : last_info.pv) {
+        if (info->pv_length == ASP_MAX_PV) {
+            break;
+        }
+        info->pv[info->pv_length++] = { static_cast<int32_t>(GetX(cell)) - 1, static_cast<int32_t>(GetY(cell)) - 1 };
+    }
+    if (!GetX(move)) {
+        engine->is_over = true;
+        return ASP_GAME_OVER;
+    }
+    info->move = { static_cast<int32_t>(GetX(move)) - 1, static_cast<int32_t>(GetY(move)) - 1 };
+    engine->played.push_back({ move, kEngine });
+    engine->is_over = engine->controller.state() != Controller::kPlaying;
+    return ASP_OK;
+}
+
+asp_status asp_engine_search(asp_engine* engine, const asp_limits* caller_limits,
+                             asp_search_info* caller_info) {
+    if (!engine || !caller_info || caller_info->struct_size < kMinSearchInfoSize ||
+        (caller_limits && caller_limits->struct_size < kMinLimitsSize)) {
+        return ASP_INVALID_ARGUMENT;
+    }
+    asp_limits full_limits;
+    asp_limits_init(&full_limits, sizeof(full_limits));
+    const asp_limits* limits = nullptr;
+    if (caller_limits) {
+        CopyStruct(&full_limits, sizeof(full_limits), caller_limits, caller_limits->struct_size);
+        limits = &full_limits;
+    }
+    const uint32_t info_size = caller_info->struct_size;
+    memset(caller_info, 0, info_size);
+    asp_search_info full_info;
+    memset(&full_info, 0, sizeof(full_info));
+    const asp_status status = Search(engine, limits, &full_info);
+    CopyStruct(caller_info, info_size, &full_info, sizeof(full_info));
+    return status;
+}
+
+void asp_engine_stop(asp_engine* engine) {
+    if (engine) {
+        engine->stop.store(true);
+    }
+}
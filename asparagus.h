@@ -0,0 +1,133 @@
+/* Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved. */
+
+#ifndef ASPARAGUS_ASPARAGUS_H
+#define ASPARAGUS_ASPARAGUS_H
+
+/*
+ * The C API of libasparagus for embedding the engine in-process.
+ *
+ * An engine plays a single game at a time on a dense board. Positions are
+ * given as the moves played so far, alternating from the first move, and the
+ * engine searches for the side to move after the last one. Coordinates are
+ * zero based. A new position that extends the previous one, including the move
+ * returned by the last search, keeps the cache of the engine.
+ *
+ * Without a time limit a search is repeatable: the same positions give the
+ * same results in every process started with the same seed.
+ *
+ * An engine may be used by one thread at a time, except asp_engine_stop which
+ * may be called from any thread during a search.
+ *
+ * The structs start with their size as the caller compiled them. New fields
+ * are only ever appended, the library reads and writes no more than the size,
+ * and takes the defaults for the fields it is not given. Initialise options and
+ * limits with the init functions, set the size of search info before a search.
+ * Structs smaller than those of version 1 are rejected.
+ *
+ * Only the asp_ functions are exported from the shared library.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define ASP_API __attribute__((visibility("default")))
+#else
+#define ASP_API
+#endif
+
+#define ASP_API_VERSION 1
+
+typedef enum asp_status {
+    ASP_OK = 0,
+    ASP_INVALID_ARGUMENT = 1,
+    /* A move of the position is off the board or on a taken cell. */
+    ASP_ILLEGAL_MOVE = 2,
+    /* The position has a five or a full board, there is nothing to search. */
+    ASP_GAME_OVER = 3,
+} asp_status;
+
+typedef struct asp_move {
+    int32_t x;
+    int32_t y;
+} asp_move;
+
+typedef struct asp_options {
+    uint32_t struct_size;
+    int32_t width;
+    int32_t height;
+    /* Overlines do not win. */
+    int32_t is_exact_five;
+    /* Black, the side that moves first, plays under the Renju restrictions. */
+    int32_t is_renju;
+    int32_t cache_size_mb;
+    /* The default limits of a search, zero time is unlimited. */
+    int32_t max_depth;
+    int32_t time_limit_ms;
+    /* Optional files, NULL or empty for the built in evaluation. */
+    const char* weights_file;
+    const char* network_file;
+    /* Zero is unlimited. */
+    int32_t max_nodes;
+} asp_options;
+
+typedef struct asp_limits {
+    uint32_t struct_size;
+    /* Zero keeps the value of the options. */
+    int32_t max_depth;
+    int32_t time_limit_ms;
+    int32_t max_nodes;
+} asp_limits;
+
+#define ASP_MAX_PV 64
+#define ASP_WIN_SCORE 1000000000
+#define ASP_MIN_WIN_SCORE (ASP_WIN_SCORE - 256)
+
+typedef struct asp_search_info {
+    uint32_t struct_size;
+    /* The move of the engine, -1 if there is none. */
+    asp_move move;
+    /* Of the last completed iteration, the score is from the side to move.
+     * Scores beyond +-ASP_MIN_WIN_SCORE are wins, ASP_WIN_SCORE less the plies
+     * to the five. */
+    int32_t depth;
+    int32_t score;
+    uint64_t nodes;
+    double time_s;
+    int32_t pv_length;
+    asp_move pv[ASP_MAX_PV];
+} asp_search_info;
+
+typedef struct asp_engine asp_engine;
+
+ASP_API int asp_api_version(void);
+
+/* Seeds the hash keys shared by all engines of the process, zero picks a random
+ * seed. Only takes effect before the first engine is created, returns
+ * ASP_INVALID_ARGUMENT afterwards. */
+ASP_API asp_status asp_seed(uint64_t seed);
+
+/* Sets the defaults, the size is sizeof the struct of the caller. Structs
+ * smaller than those of version 1 are left alone. */
+ASP_API void asp_options_init(asp_options* options, uint32_t struct_size);
+ASP_API void asp_limits_init(asp_limits* limits, uint32_t struct_size);
+
+/* Returns NULL if the options are invalid or a file cannot be loaded. */
+ASP_API asp_engine* asp_engine_create(const asp_options* options);
+ASP_API void asp_engine_destroy(asp_engine* engine);
+
+ASP_API asp_status asp_engine_set_position(asp_engine* engine, const asp_move* moves, int32_t count);
+/* Searches the position, NULL limits use the options. The move found is played
+ * on the board of the engine. */
+ASP_API asp_status asp_engine_search(asp_engine* engine, const asp_limits* limits, asp_search_info* info);
+/* Ends the running search, the best move found so far is returned. */
+ASP_API void asp_engine_stop(asp_engine* engine);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif  /* ASPARAGUS_ASPARAGUS_H */
@@ -0,0 +1,264 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "board.h"
+#include "config.h"
+#include "engine.h"
+#include "mapped_file.h"
+#include "position_stream.h"
+
+namespace asparagus {
+
+// The engine always plays the O stones.
+static void SetEngineToMove(Board* board, Stone to_move) {
+    if (to_move == kPlayer) {
+        for (int y = 1; y <= board->height(); y++) {
+            for (int x = 1; x <= board->width(); x++) {
+                const Cell cell = MakeCell(x, y);
+                if (IsStone(board->stone(cell))) {
+                    board->Set(cell, board->stone(cell) ^ kForbidden);
+                }
+            }
+        }
+    }
+}
+
+BatchAnalyzer::BatchAnalyzer(const Config& config)
+    :   config_(config),
+        end_(nullptr),
+        reader_(nullptr),
+        count_(0),
+        is_complete_(false),
+        next_(0) {}
+
+bool BatchAnalyzer::Run(const std::string& path, std::ostream& out) {
+    if (path == "-") {
+        // Text positions start with their size, only a stream starts with the
+        // 'A' of its magic.
+        if (std::cin.peek() == 'A') {
+            PositionReader reader(std::cin);
+            Run(&reader, out);
+        } else {
+            Run(std::cin, out);
+        }
+        return true;
+    }
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    if (PositionStream::IsHeader(file.data(), file.size())) {
+        Run(file.data(), file.size(), out);
+    } else {
+        std::ifstream in(path);
+        Run(in, out);
+    }
+    return true;
+}
+
+size_t BatchAnalyzer::Run(std::istream& in, std::ostream& out) {
+    positions_.clear();
+    records_.clear();
+    reader_ = nullptr;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") != std::string::npos && line[0] != '#') {
+            positions_.push_back(line);
+        }
+    }
+    count_ = positions_.size();
+    return Analyze(out);
+}
+
+size_t BatchAnalyzer::Run(const uint8_t* data, size_t size, std::ostream& out) {
+    positions_.clear();
+    records_.clear();
+    reader_ = nullptr;
+    end_ = data + size;
+    // Only the record boundaries are collected here, the workers decode the
+    // records straight from the buffer.
+    for (size_t offset = PositionStream::kHeaderSize; offset + PositionStream::kRecordHeaderSize <= size;) {
+        records_.push_back(data + offset);
+        offset += PositionStream::GetRecordSize(data[offset], data[offset + 1]);
+    }
+    count_ = records_.size();
+    return Analyze(out);
+}
+
+size_t BatchAnalyzer::Run(PositionReader* reader, std::ostream& out) {
+    positions_.clear();
+    records_.clear();
+    reader_ = reader;
+    count_ = 0;
+    return Analyze(out);
+}
+
+size_t BatchAnalyzer::Analyze(std::ostream& out) {
+    is_complete_ = reader_ == nullptr;
+    results_.clear();
+    next_.store(0);
+
+    int thread_count = config_.threads();
+    if (thread_count <= 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; i++) {
+        threads.emplace_back(&BatchAnalyzer::Work, this, config_.cache_size() / thread_count);
+    }
+    for (size_t i = 0;; i++) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this, i]() { return results_.count(i) || (is_complete_ && i >= count_); });
+        const auto result = results_.find(i);
+        if (result == results_.end()) {
+            break;
+        }
+        out << result->second << std::endl;
+        results_.erase(result);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+    std::cerr << "analysed " << count_ << " positions in " << duration.count()
+              << " s on " << thread_count << " threads ("
+              << double(count_) / duration.count() << " positions/sec)" << std::endl;
+    return count_;
+}
+
+bool BatchAnalyzer::NextPosition(size_t* index, Board* board, bool* is_valid) {
+    if (!reader_) {
+        *index = next_.fetch_add(1);
+        if (*index >= count_) {
+            return false;
+        }
+        *is_valid = LoadPosition(*index, board);
+        return true;
+    }
+    std::lock_guard<std::mutex> read_lock(read_mutex_);
+    Stone to_move;
+    const bool is_read = reader_->Read(board, &to_move);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (is_read) {
+            *index = count_++;
+        } else {
+            is_complete_ = true;
+        }
+    }
+    if (!is_read) {
+        done_.notify_one();
+        return false;
+    }
+    SetEngineToMove(board, to_move);
+    *is_valid = true;
+    return true;
+}
+
+bool BatchAnalyzer::LoadPosition(size_t index, Board* board) const {
+    if (records_.empty()) {
+        return ParsePosition(positions_[index], board);
+    }
+    Stone to_move;
+    const uint8_t* record = records_[index];
+    if (!PositionStream::Decode(record, end_ - record, board, &to_move)) {
+        return false;
+    }
+    SetEngineToMove(board, to_move);
+    return true;
+}
+
+bool BatchAnalyzer::ParsePosition(const std::string& line, Board* board) {
+    std::istringstream in(line);
+    std::string size;
+    int width;
+    int height;
+    if (!(in >> size)) {
+        return false;
+    }
+    if (sscanf(size.c_str(), "%dx%d", &width, &height) != 2) {
+        if (sscanf(size.c_str(), "%d", &width) != 1) {
+            return false;
+        }
+        height = width;
+    }
+    if (width < Board::kMinSize || width > Board::kMaxSize ||
+        height < Board::kMinSize || height > Board::kMaxSize) {
+        return false;
+    }
+    board->Initialize(width, height);
+
+    std::vector<std::string> tokens;
+    std::string token;
+    while (in >> token) {
+        tokens.push_back(token);
+    }
+    if (tokens.size() == 1 && tokens[0].find_first_not_of("+OX/") == std::string::npos) {
+        int x = 1;
+        int y = 1;
+        for (char ch : tokens[0]) {
+            if (ch == '/') {
+                x = 1;
+                y += 1;
+                continue;
+            }
+            if (x > width || y > height) {
+                return false;
+            }
+            if (ch != '+') {
+                board->Set(MakeCell(x, y), ch == 'O' ? kEngine : kPlayer);
+            }
+            x += 1;
+        }
+        return true;
+    }
+    for (size_t i = 0; i < tokens.size(); i++) {
+        int x;
+        int y;
+        if (sscanf(tokens[i].c_str(), "%d,%d", &x, &y) != 2) {
+            return false;
+        }
+        const Cell cell = MakeCell(x, y);
+        if (x <= 0 || x > width || y <= 0 || y > height || board->stone(cell) != kEmpty) {
+            return false;
+        }
+        board->Set(cell, (tokens.size() - i) % 2 ? kPlayer : kEngine);
+    }
+    return true;
+}
+
+void BatchAnalyzer::Work(uint64_t cache_size) {
+    Board board;
+    Engine engine(config_, cache_size);
+    engine.Start();
+    size_t i;
+    bool is_valid;
+    while (NextPosition(&i, &board, &is_valid)) {
+        std::ostringstream result;
+        if (is_valid) {
+            const Cell move = engine.GetBestMove(&board);
+            const SearchInfo& info = engine.last_info();
+            result << GetX(move) << " " << GetY(move) << " score " << info.score
+                   << " depth " << info.depth << " nodes " << info.nodes;
+        } else {
+            result << "error: invalid position: " << i + 1;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            results_[i] = result.str();
+        }
+        done_.notify_one();
+    }
+}
+
+}  // namespace asparagus
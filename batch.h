@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_BATCH_H
+#define ASPARAGUS_BATCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+namespace asparagus {
+
+class Board;
+class Config;
+class PositionReader;
+
+// Analyses a list of positions on a pool of worker threads. Every worker owns a
+// Board and an Engine with an equal share of the cache. Results are streamed in
+// input order, one line per position:
+//   <x> <y> score <score> depth <depth> nodes <nodes>
+// The input is either a PositionStream or text with one position per line. A
+// text position is the board size (N or WxH) followed by either the moves played
+// so far ("8,8 9,9 ...", alternating, the engine is to move after the last one)
+// or a board dump with rows separated by '/' ("+++O+/..."), O marks the stones
+// of the side to move.
+class BatchAnalyzer final {
+public:
+    explicit BatchAnalyzer(const Config& config);
+
+    // Analyses the given file, "-" reads the standard input. Returns false if the
+    // file cannot be read.
+    bool Run(const std::string& path, std::ostream& out);
+    // All return the number of analysed positions.
+    size_t Run(std::istream& in, std::ostream& out);
+    size_t Run(const uint8_t* data, size_t size, std::ostream& out);
+    // The records are decoded as the workers ask for them, so a pipe is never
+    // held in memory as a whole.
+    size_t Run(PositionReader* reader, std::ostream& out);
+
+    static bool ParsePosition(const std::string& line, Board* board);
+
+private:
+    const Config& config_;
+    std::vector<std::string> positions_;
+    std::vector<const uint8_t*> records_;
+    const uint8_t* end_;
+    PositionReader* reader_;
+    // Grows while a reader is used, is_complete_ tells when it is final.
+    size_t count_;
+    bool is_complete_;
+    // Results waiting for the earlier ones to be written.
+    std::map<size_t, std::string> results_;
+    std::atomic<size_t> next_;
+    std::mutex mutex_;
+    std::mutex read_mutex_;
+    std::condition_variable done_;
+
+    size_t Analyze(std::ostream& out);
+    // Returns false once the input is used up, is_valid is false for a position
+    // that cannot be loaded.
+    bool NextPosition(size_t* index, Board* board, bool* is_valid);
+    bool LoadPosition(size_t index, Board* board) const;
+    void Work(uint64_t cache_size);
+
+    DISALLOW_COPY_AND_ASSIGN(BatchAnalyzer);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_BATCH_H
@@ -5,7 +5,8 @@
 #include <algorithm>
 #include <cstring>
 
-#include "cell_set.h"
+#include "move_stack.h"
+#include "network.h"
 #include "randoms.h"
 
 namespace asparagus {
@@ -19,53 +20,118 @@ static int CountSimilar(Stone stone, const Stone* cell, int stride) {
     return count;
 }
 
+// Renju shapes are judged on a window of the line through the examined cell,
+// the cell itself sits in the middle of the window.
+static constexpr int kLineRadius = 5;
+static constexpr int kLineSize = 2 * kLineRadius + 1;
+
+static int GetRunLength(const Stone* line, int index, Stone stone) {
+    int first = index;
+    while (first > 0 && line[first - 1] == stone) {
+        first -= 1;
+    }
+    int last = index;
+    while (last < kLineSize - 1 && line[last + 1] == stone) {
+        last += 1;
+    }
+    return last - first + 1;
+}
+
+// Counts the empty cells that complete a five through the middle of the line,
+// the first two of them are returned in points.
+static int GetFivePoints(Stone* line, Stone stone, bool is_exact, int points[2]) {
+    int count = 0;
+    for (int i = 1; i < kLineSize - 1; i++) {
+        if (line[i] != kEmpty) {
+            continue;
+        }
+        line[i] = stone;
+        const int run = GetRunLength(line, kLineRadius, stone);
+        if (run == 5 || (!is_exact && run > 5)) {
+            if (count < 2) {
+                points[count] = i;
+            }
+            count += 1;
+        }
+        line[i] = kEmpty;
+    }
+    return count;
+}
+
+// Number of fours through the middle of the line, a line such as X_XXX_X
+// holds two of them.
+static int CountFours(Stone* line, Stone stone, bool is_exact) {
+    int points[2];
+    const int count = GetFivePoints(line, stone, is_exact, points);
+    if (count == 2 && points[1] - points[0] == 5) {
+        return 1;
+    }
+    return std::min(count, 2);
+}
+
+// An open three is one move away from a straight four, that is a four with two
+// completion points on both ends.
+static bool IsOpenThree(Stone* line, Stone stone, bool is_exact) {
+    for (int i = 1; i < kLineSize - 1; i++) {
+        if (line[i] != kEmpty) {
+            continue;
+        }
+        line[i] = stone;
+        int points[2];
+        const bool is_straight_four = GetFivePoints(line, stone, is_exact, points) == 2 &&
+                                      points[1] - points[0] == 5;
+        line[i] = kEmpty;
+        if (is_straight_four) {
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr int Board::kLineStrides[4];
+
 Board::Board()
     :   width_(0),
         height_(0),
-        hash_(0) {
+        hash_(0),
+        black_(kEmpty),
+        accumulator_(nullptr) {
     memset(stones_, 0, sizeof(stones_));
-    memset(axes_, 0, sizeof(axes_));
+    memset(forbidden_, 0, sizeof(forbidden_));
 }
 
 void Board::Initialize(int width, int height) {
-    // static const int kStrides[4] = { kDownLeft, kLeft, kUpLeft, kUp };
-    static const int kStrides[8] = {
-        kDownLeft, kLeft, kUpLeft, kUp, kUpRight, kRight, kDownRight, kDown,
-    };
-
     width_ = width;
     height_ = height;
     hash_ = 0;
-
-    last_ = kStride * (height + 2) + 1;
+    black_ = kEmpty;
+    memset(forbidden_, 0, sizeof(forbidden_));
 
     memset(stones_, kBoundary, kStorageSize);
-    memset(axes_, 0, sizeof(axes_));
     for (int y = 1; y <= height; y++) {
         memset(stones_ + MakeCell(1, y), kEmpty, width);
     }
-    for (int y = 0; y < kStride; y++) {
-        for (int x = 0; x < kStride; x++) {
-            const Cell base = MakeCell(x, y);
-            if (!IsInside(base)) {
-                continue;
-            }
-            for (int stride = 0; stride < 8; stride++) {
-                Cell value = base + kStrides[stride];
-                const Stone* board = cell(base);
-                for (int i = 0; *board == kEmpty && i < kMaxAxisLength; i++) {
-                    axes_[base][stride][i] = value;
-                    value += kStrides[stride];
-                }
-            }
-        }
+    if (accumulator_) {
+        accumulator_->Refresh(*this);
+    }
+}
+
+void Board::Clear() {
+    hash_ = 0;
+    black_ = kEmpty;
+    memset(forbidden_, 0, sizeof(forbidden_));
+    for (int y = 1; y <= height_; y++) {
+        memset(stones_ + MakeCell(1, y), kEmpty, width_);
+    }
+    if (accumulator_) {
+        accumulator_->Refresh(*this);
     }
 }
 
 bool Board::IsInside(Cell cell) const {
     const unsigned int x = GetX(cell);
     const unsigned int y = GetY(cell);
-    return x > 0 && x <= width_ && y > 0 && y < height_;
+    return x > 0 && x <= width_ && y > 0 && y <= height_;
 }
 
 bool Board::IsEmptyCell(Cell move) const {
@@ -73,6 +139,10 @@ bool Board::IsEmptyCell(Cell move) const {
 }
 
 bool Board::IsTerminalMove(Cell move, Stone stone, bool is_exact_five) const {
+    // Under Renju only an exact five wins for black, white wins by overlines too.
+    if (black_) {
+        is_exact_five = stone == black_;
+    }
     static int kStrides[4][2] = {
         { kUp, kDown },
         { kUpRight, kDownLeft },
@@ -93,66 +163,206 @@ bool Board::IsTerminalMove(Cell move, Stone stone, bool is_exact_five) const {
 void Board::Set(Cell cell, Stone stone) {
     hash_ ^= kRandoms[cell][stones_[cell]];
     hash_ ^= kRandoms[cell][stone];
+    if (accumulator_) {
+        accumulator_->Update(cell, stones_[cell], stone);
+    }
     stones_[cell] = stone;
+    if (black_) {
+        UpdateForbidden(cell);
+    }
 }
 
-void Board::GetCellsToEvaluate(int dist, CellSet* cells) const {
-    static const int kStrides[4] = { kDownLeft, kLeft, kUpLeft, kUp };
-    uint8_t flags[kStorageSize];
-    memset(flags, 0, sizeof(flags));
-
-    /*
-    for (Cell cell = kStride + 1; cell < last_; cell++) {
-        if (IsStone(stones_[cell])) {
-            for (int direction = 0; direction < 4; direction++) {
-                for (int i = 0; i < dist; i++) {
-                    flags[axes_[cell][direction][i]] = 1;
-                }
+void Board::SetRenju(Stone black) {
+    black_ = black;
+    memset(forbidden_, 0, sizeof(forbidden_));
+    if (!black_) {
+        return;
+    }
+    for (int y = 1; y <= height_; y++) {
+        for (int x = 1; x <= width_; x++) {
+            const Cell cell = MakeCell(x, y);
+            forbidden_[cell] = !stones_[cell] && IsForbiddenMove(cell);
+        }
+    }
+}
+
+void Board::Attach(NetworkAccumulator* accumulator) {
+    accumulator_ = accumulator;
+    if (accumulator_) {
+        accumulator_->Refresh(*this);
+    }
+}
+
+Board::Threat Board::GetThreat(Cell cell, Stone stone, bool is_exact_five) const {
+    const bool is_exact = stone == black_ || is_exact_five;
+    Threat threat = kNoThreat;
+    int fours = 0;
+    for (auto stride : kLineStrides) {
+        Stone line[kLineSize];
+        const int count = GetLine(cell, stride, stone, line);
+        if (count < 2) {
+            continue;
+        }
+        const int run = GetRunLength(line, kLineRadius, stone);
+        if (run == 5 || (!is_exact && run > 5)) {
+            return kThreatFive;
+        }
+        int points[2];
+        const int fives = count >= 3 ? GetFivePoints(line, stone, is_exact, points) : 0;
+        if (fives) {
+            // Two completion points in one line cannot both be blocked.
+            fours += fives >= 2 ? 2 : 1;
+            threat = std::max(threat, fives >= 2 ? kThreatStraightFour : kThreatFour);
+        } else if (threat < kThreatThree && IsOpenThree(line, stone, is_exact)) {
+            threat = kThreatThree;
+        }
+    }
+    return fours >= 2 ? kThreatStraightFour : threat;
+}
+
+int Board::GetLine(Cell cell, int stride, Stone stone, Stone* line) const {
+    int count = 0;
+    line[kLineRadius] = stone;
+    for (int sign = -1; sign <= 1; sign += 2) {
+        Cell next = cell;
+        for (int i = 1; i <= kLineRadius; i++) {
+            Stone value = kBoundary;
+            if (stones_[next] != kBoundary) {
+                next += sign * stride;
+                value = stones_[next];
             }
+            line[kLineRadius + sign * i] = value;
+            count += value == stone;
         }
     }
-    */
+    return count;
+}
 
-    for (int y = 1; y <= height_; y++) {
-        for (int x = 1; x <= width_; x++) {
-            const Cell base = MakeCell(x, y);
-            if (IsStone(stones_[base])) {
-                for (auto stride : kStrides) {
-                    Cell cell = base;
-                    for (int i = 0; i < dist && stones_[cell] != kBoundary; i++, cell += stride) {
-                        flags[cell] = 1u;
-                    }
+bool Board::IsForbiddenMove(Cell cell) const {
+    Stone lines[4][kLineSize];
+    int stones[4];
+    int total = 0;
+    for (int d = 0; d < 4; d++) {
+        Stone* line = lines[d];
+        stones[d] = GetLine(cell, kLineStrides[d], black_, line);
+        total += stones[d];
+        // A five is a win, it is never forbidden.
+        const int run = GetRunLength(line, kLineRadius, black_);
+        if (run == 5) {
+            return false;
+        }
+    }
+    // A double three takes at least four more black stones around the cell.
+    if (total < 4) {
+        return false;
+    }
+
+    int fours = 0;
+    int threes = 0;
+    for (int d = 0; d < 4; d++) {
+        Stone* line = lines[d];
+        if (GetRunLength(line, kLineRadius, black_) > 5) {
+            return true;
+        }
+        if (stones[d] < 2) {
+            continue;
+        }
+        const int count = stones[d] >= 3 ? CountFours(line, black_, true) : 0;
+        if (count) {
+            fours += count;
+        } else if (IsOpenThree(line, black_, true)) {
+            threes += 1;
+        }
+    }
+    return fours >= 2 || threes >= 2;
+}
+
+void Board::UpdateForbidden(Cell cell) {
+    // A stone changes the shapes of the lines within the window around it.
+    static const int kStrides[8] = {
+        kDownLeft, kLeft, kUpLeft, kUp, kUpRight, kRight, kDownRight, kDown,
+    };
+    // A white stone only blocks shapes, it can lift restrictions but never adds
+    // new ones.
+    const bool is_blocking = IsStone(stones_[cell]) && stones_[cell] != black_;
+    forbidden_[cell] = !stones_[cell] && IsForbiddenMove(cell);
+    for (auto stride : kStrides) {
+        Cell next = cell + stride;
+        for (int i = 0; i < kLineRadius && stones_[next] != kBoundary; i++, next += stride) {
+            if (!is_blocking || forbidden_[next]) {
+                forbidden_[next] = !stones_[next] && IsForbiddenMove(next);
+            }
+        }
+    }
+}
+
+void Board::GetCellsToEvaluate(int dist, CellMarker* marker, MoveList* cells) const {
+    GetCellsToEvaluate<RuntimeGeometry>(dist, marker, cells);
+}
+
+void Board::GetPossibleMoves(int dist, CellMarker* marker, MoveList* moves) const {
+    GetPossibleMoves<RuntimeGeometry>(dist, marker, moves);
+}
+
+template <typename Geometry>
+void Board::GetCellsToEvaluate(int dist, CellMarker* marker, MoveList* cells) const {
+    static const int kStrides[4] = { kDownLeft, kLeft, kUpLeft, kUp };
+    const Cell first = MakeCell(1, 1);
+    const Cell last = MakeCell(Geometry::width(*this), Geometry::height(*this)) + 1;
+    marker->NewGeneration();
+
+    for (Cell base = first; base < last; base++) {
+        if (IsStone(stones_[base])) {
+            for (auto stride : kStrides) {
+                Cell cell = base;
+                for (int i = 0; i < dist && stones_[cell] != kBoundary; i++, cell += stride) {
+                    marker->Mark(cell);
                 }
             }
         }
     }
 
-    for (Cell cell = kStride + 1; cell < last_; cell++) {
-        if (flags[cell] && stones_[cell] != kBoundary) {
+    for (Cell cell = first; cell < last; cell++) {
+        if (marker->IsMarked(cell) && stones_[cell] != kBoundary) {
             cells->insert(cell);
         }
     }
 }
 
-void Board::GetPossibleMoves(int dist, CellSet* cells) const {
-    uint8_t flags[kStorageSize];
-    memset(flags, 0, sizeof(flags));
+template <typename Geometry>
+void Board::GetPossibleMoves(int dist, CellMarker* marker, MoveList* moves) const {
+    static const int kStrides[8] = {
+        kDownLeft, kLeft, kUpLeft, kUp, kUpRight, kRight, kDownRight, kDown,
+    };
+    const Cell first = MakeCell(1, 1);
+    const Cell last = MakeCell(Geometry::width(*this), Geometry::height(*this)) + 1;
+    marker->NewGeneration();
 
-    for (Cell cell = kStride + 1; cell < last_; cell++) {
-        if (IsStone(stones_[cell])) {
-            for (int direction = 0; direction < 8; direction++) {
-                for (int i = 0; i < dist; i++) {
-                    flags[axes_[cell][direction][i]] = 1;
+    for (Cell base = first; base < last; base++) {
+        if (IsStone(stones_[base])) {
+            for (auto stride : kStrides) {
+                Cell cell = base + stride;
+                for (int i = 0; i < dist && stones_[cell] != kBoundary; i++, cell += stride) {
+                    marker->Mark(cell);
                 }
             }
         }
     }
 
-    for (Cell cell = kStride + 1; cell < last_; cell++) {
-        if (flags[cell] && !stones_[cell]) {
-            cells->insert(cell);
+    for (Cell cell = first; cell < last; cell++) {
+        if (marker->IsMarked(cell) && !stones_[cell]) {
+            moves->insert(cell);
         }
     }
 }
 
+template void Board::GetCellsToEvaluate<Geometry15>(int dist, CellMarker* marker, MoveList* cells) const;
+template void Board::GetCellsToEvaluate<Geometry19>(int dist, CellMarker* marker, MoveList* cells) const;
+template void Board::GetCellsToEvaluate<Geometry20>(int dist, CellMarker* marker, MoveList* cells) const;
+template void Board::GetCellsToEvaluate<RuntimeGeometry>(int dist, CellMarker* marker, MoveList* cells) const;
+template void Board::GetPossibleMoves<Geometry15>(int dist, CellMarker* marker, MoveList* moves) const;
+template void Board::GetPossibleMoves<Geometry19>(int dist, CellMarker* marker, MoveList* moves) const;
+template void Board::GetPossibleMoves<Geometry20>(int dist, CellMarker* marker, MoveList* moves) const;
+template void Board::GetPossibleMoves<RuntimeGeometry>(int dist, CellMarker* marker, MoveList* moves) const;
+
 }  // namespace asparagus
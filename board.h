@@ -7,7 +7,28 @@
 
 namespace asparagus {
 
-class CellSet;
+class Board;
+class CellMarker;
+class MoveList;
+class NetworkAccumulator;
+
+// Board dimensions known at compile time. The board scans and the search are
+// instantiated for the common sizes so that the loop bounds fold into constants,
+// RuntimeGeometry is the fallback for every other size.
+template <int kWidth, int kHeight>
+struct FixedGeometry {
+    static constexpr int width(const Board&) { return kWidth; }
+    static constexpr int height(const Board&) { return kHeight; }
+};
+
+struct RuntimeGeometry {
+    static int width(const Board& board);
+    static int height(const Board& board);
+};
+
+using Geometry15 = FixedGeometry<15, 15>;
+using Geometry19 = FixedGeometry<19, 19>;
+using Geometry20 = FixedGeometry<20, 20>;
 
 class Board final {
 public:
@@ -25,6 +46,9 @@ public:
     static constexpr int kDownLeft = kDown + kLeft;
     static constexpr int kUpLeft = kUp + kLeft;
 
+    // The strongest shape a stone would make on an empty cell.
+    enum Threat { kNoThreat, kThreatThree, kThreatFour, kThreatStraightFour, kThreatFive };
+
     Board();
 
     constexpr int width() const { return width_; }
@@ -33,31 +57,62 @@ public:
     constexpr bool empty() const { return !hash_; }
     constexpr Stone stone(Cell cell) const { return stones_[cell]; }
     constexpr const Stone* cell(Cell cell) const { return stones_ + cell; }
+    // The colour that plays under the Renju restrictions, kEmpty without Renju.
+    constexpr Stone black() const { return black_; }
+    constexpr bool IsForbidden(Cell cell) const { return forbidden_[cell] != 0; }
+    constexpr NetworkAccumulator* accumulator() const { return accumulator_; }
 
     bool IsInside(Cell cell) const;
     bool IsEmptyCell(Cell move) const;
     bool IsTerminalMove(Cell move, Stone stone, bool is_exact_five) const;
+    // Fives are exact for black under Renju and for both sides under the exact
+    // five rule, overlines count otherwise. Two fours of a single move are
+    // reported as a straight four. On an occupied cell it judges the move that
+    // placed the stone.
+    Threat GetThreat(Cell cell, Stone stone, bool is_exact_five) const;
 
     void Initialize(int width, int height);
+    void Clear();
     void Set(Cell cell, Stone stone);
-    void GetCellsToEvaluate(int dist, CellSet* cells) const;
-    void GetPossibleMoves(int dist, CellSet* cells) const;
+    // Turns on the Renju restrictions for the given colour, kEmpty turns them off.
+    void SetRenju(Stone black);
+    // Keeps the accumulator up to date with the stones from now on, it is
+    // refreshed first. nullptr detaches the current one.
+    void Attach(NetworkAccumulator* accumulator);
+    // The scans collect cells in board order, the marker is scratch space.
+    void GetCellsToEvaluate(int dist, CellMarker* marker, MoveList* cells) const;
+    void GetPossibleMoves(int dist, CellMarker* marker, MoveList* moves) const;
+
+    template <typename Geometry>
+    void GetCellsToEvaluate(int dist, CellMarker* marker, MoveList* cells) const;
+    template <typename Geometry>
+    void GetPossibleMoves(int dist, CellMarker* marker, MoveList* moves) const;
 
 private:
-    static constexpr int kMaxAxisLength = 5;
-
     int width_;
     int height_;
 
-    Cell last_;
-
     uint64_t hash_;
     Stone stones_[kStorageSize];
-    Cell axes_[kStorageSize][8][kMaxAxisLength];
+    Stone black_;
+    // Empty cells where black may not move, kept up to date by Set.
+    uint8_t forbidden_[kStorageSize];
+    NetworkAccumulator* accumulator_;
+
+    static constexpr int kLineStrides[4] = { kRight, kDown, kDownRight, kUpRight };
+
+    // Copies the line through the cell into a window centred on the cell, the
+    // stone is placed in the middle. Returns the number of stones like it.
+    int GetLine(Cell cell, int stride, Stone stone, Stone* line) const;
+    bool IsForbiddenMove(Cell cell) const;
+    void UpdateForbidden(Cell cell);
 
     DISALLOW_COPY_AND_ASSIGN(Board);
 };
 
+inline int RuntimeGeometry::width(const Board& board) { return board.width(); }
+inline int RuntimeGeometry::height(const Board& board) { return board.height(); }
+
 }  // namespace asparagus
 
 #endif  // ASPARAGUS_BOARD_H
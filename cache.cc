@@ -6,6 +6,10 @@
 
 namespace asparagus {
 
+#ifdef PACKED_CACHE_ENTRY
+static_assert(sizeof(Cache::Entry) == 8, "packed cache entries take 8 bytes");
+#endif  // PACKED_CACHE_ENTRY
+
 Cache::Cache(uint64_t size)
     :   ply_(0) {
     entry_num_ = size / sizeof(Entry);
@@ -21,7 +25,6 @@ void Cache::Reset() {
     memset(entries_, 0, entry_num_ * sizeof(Entry));
 
     #ifdef COLLECT_STATISTICS
-    used_entries_ = 0;
     lookup_count_ = 0;
     collision_count_ = 0;
     hit_count_ = 0;
@@ -37,34 +40,37 @@ Cache::Entry* Cache::Find(uint64_t hash, bool* found) {
     lookup_count_ += 1ull;
     #endif  // COLLECT_STATISTICS
     Entry* entry = entries_ + (hash >> 32u) % entry_num_;
-    if (entry->hash_ == hash) {
+    if (entry->Matches(hash)) {
         #ifdef COLLECT_STATISTICS
-        lookup_count_ += 1ull;
         hit_count_ += 1ull;
         #endif  // COLLECT_STATISTICS
         *found = true;
     } else {
         #ifdef COLLECT_STATISTICS
-        if (entry->hash_) {
-            if (entry->age_ > (ply_ - 1)) {
-                collision_count_ += 1ull;
-            }
-        } else {
-            used_entries_ += 1ull;
+        if (entry->IsUsed() && entry->age_ == (ply_ & kAgeMask)) {
+            collision_count_ += 1ull;
         }
         #endif  // COLLECT_STATISTICS
         *found = false;
-        entry->hash_ = hash;
     }
-    entry->age_ = ply_;
+    entry->age_ = ply_ & kAgeMask;
     return entry;
 }
 
+const Cache::Entry* Cache::Probe(uint64_t hash) const {
+    const Entry* entry = entries_ + (hash >> 32u) % entry_num_;
+    return entry->Matches(hash) && entry->type_ != Entry::kEmpty ? entry : nullptr;
+}
+
 #ifdef COLLECT_STATISTICS
 void Cache::PrintStats(std::ostream& out) {
+    uint64_t used_entries = 0;
+    for (uint64_t i = 0; i < entry_num_; i++) {
+        used_entries += entries_[i].IsUsed();
+    }
     out << "cache stats:" << std::endl;
-    out << "  entries       : " << used_entries_ << std::endl;
-    out << "  usage         : " << 100.0 * double(used_entries_) / double(entry_num_) << " %" << std::endl;
+    out << "  entries       : " << used_entries << std::endl;
+    out << "  usage         : " << 100.0 * double(used_entries) / double(entry_num_) << " %" << std::endl;
     out << "  hit rate      : " << 100.0 * double(hit_count_) / double(lookup_count_) << " %" << std::endl;
     out << "  collision rate: " << 100.0 * double(collision_count_) / double(lookup_count_) << " %" << std::endl;
 }
@@ -4,6 +4,11 @@
 #define ASPARAGUS_CACHE_H
 
 #include "common.h"
+#include "score.h"
+
+#ifdef PACKED_CACHE_ENTRY
+#include <algorithm>
+#endif  // PACKED_CACHE_ENTRY
 
 #ifdef COLLECT_STATISTICS
 #include <ostream>
@@ -25,23 +30,107 @@ public:
 
         constexpr uint8_t type() const { return type_; }
         constexpr uint8_t depth() const { return depth_; }
-        constexpr float value() const { return value_; }
         constexpr Cell best_move() const { return best_move_; }
-
-        void Store(uint8_t type, uint8_t depth, float value, Cell best_move) {
+        #ifdef PACKED_CACHE_ENTRY
+        Score value() const { return Unpack(static_cast<int16_t>(value_)); }
+        #else  // PACKED_CACHE_ENTRY
+        constexpr Score value() const { return value_; }
+        #endif  // PACKED_CACHE_ENTRY
+
+        // Claims the entry for the position, Find leaves a missed entry alone as
+        // the search below may reuse it before the result is stored.
+        void Store(uint64_t hash, uint8_t type, uint8_t depth, Score value, Cell best_move) {
+            #ifdef PACKED_CACHE_ENTRY
+            key_ = GetKey(hash);
+            value_ = static_cast<uint16_t>(Pack(value, type));
+            #else  // PACKED_CACHE_ENTRY
+            hash_ = hash;
+            value_ = value;
+            #endif  // PACKED_CACHE_ENTRY
             type_ = type & 0x3u;
             depth_ = depth;
-            value_ = value;
             best_move_ = best_move;
         }
 
     private:
+        #ifdef PACKED_CACHE_ENTRY
+        // The bucket index is taken from the high half of the hash, the key from
+        // the low bits, so together they check 16 more bits of the hash.
+        static constexpr uint64_t GetKey(uint64_t hash) { return hash & 0xffffu; }
+
+        bool Matches(uint64_t hash) const { return type_ != kEmpty && key_ == GetKey(hash); }
+        bool IsUsed() const { return type_ != kEmpty; }
+
+        // Values are packed into 16 bits: small ones as they are, larger
+        // evaluations with kMantissaBits of precision, and the wins and the
+        // infinities exactly at the ends of the range. Rounded bounds only
+        // ever get looser.
+        static constexpr int kExactBits = 11;
+        static constexpr int kMantissaBits = 10;
+        static constexpr int32_t kMaxCode = 0x7fff;
+        static constexpr int32_t kFirstWinCode = kMaxCode - (kInfinity - kMinWinScore);
+
+        static int32_t Pack(Score value, uint8_t type) {
+            const bool is_negative = value < 0;
+            uint32_t magnitude = static_cast<uint32_t>(is_negative ? -value : value);
+            int32_t code;
+            if (magnitude >= static_cast<uint32_t>(kMinWinScore)) {
+                code = kMaxCode - static_cast<int32_t>(kInfinity - magnitude);
+            } else if (magnitude < 1u << kExactBits) {
+                code = static_cast<int32_t>(magnitude);
+            } else {
+                magnitude = std::min(magnitude, static_cast<uint32_t>(kMaxEvaluation));
+                unsigned int shift = 1;
+                while (magnitude >> shift >= 2u << kMantissaBits) {
+                    shift += 1;
+                }
+                // A lower bound may only go down, an upper bound only up.
+                const bool is_up = is_negative ? type == kLowerBound : type == kUpperBound;
+                const bool is_down = is_negative ? type == kUpperBound : type == kLowerBound;
+                const uint32_t bias = is_up ? (1u << shift) - 1u : is_down ? 0u : 1u << (shift - 1u);
+                // A carry out of the mantissa moves on to the next power of two.
+                const uint32_t mantissa = (magnitude + bias) >> shift;
+                code = (1 << kExactBits) + static_cast<int32_t>((shift - 1u) << kMantissaBits) +
+                       static_cast<int32_t>(mantissa - (1u << kMantissaBits));
+            }
+            return is_negative ? -code : code;
+        }
+
+        static Score Unpack(int32_t code) {
+            const bool is_negative = code < 0;
+            if (is_negative) {
+                code = -code;
+            }
+            Score magnitude;
+            if (code >= kFirstWinCode) {
+                magnitude = kInfinity - (kMaxCode - code);
+            } else if (code < 1 << kExactBits) {
+                magnitude = code;
+            } else {
+                const int32_t offset = code - (1 << kExactBits);
+                const unsigned int shift = static_cast<unsigned int>(offset >> kMantissaBits) + 1u;
+                magnitude = static_cast<Score>(((offset & ((1 << kMantissaBits) - 1)) + (1 << kMantissaBits)) << shift);
+            }
+            return is_negative ? -magnitude : magnitude;
+        }
+
+        uint64_t key_        : 16;
+        uint64_t value_      : 16;
+        uint64_t depth_      : 8;
+        uint64_t type_       : 2;
+        uint64_t best_move_  : 10;
+        uint64_t age_        : 12;
+        #else  // PACKED_CACHE_ENTRY
+        bool Matches(uint64_t hash) const { return hash_ == hash; }
+        bool IsUsed() const { return hash_ != 0; }
+
         uint64_t hash_;
         uint32_t type_       : 2;
         uint32_t depth_      : 8;
         uint32_t age_        : 10;
         uint32_t best_move_  : 10;
-        float value_;
+        Score value_;
+        #endif  // PACKED_CACHE_ENTRY
 
         DISALLOW_COPY_AND_ASSIGN(Entry);
     };
@@ -52,18 +141,24 @@ public:
     void Reset();
     void NewSearch();
     Entry* Find(uint64_t hash, bool* found);
+    const Entry* Probe(uint64_t hash) const;
 
     #ifdef COLLECT_STATISTICS
     void PrintStats(std::ostream& out);
     #endif  // COLLECT_STATISTICS
 
 private:
+    #ifdef PACKED_CACHE_ENTRY
+    static constexpr unsigned int kAgeMask = 0xfffu;
+    #else  // PACKED_CACHE_ENTRY
+    static constexpr unsigned int kAgeMask = 0x3ffu;
+    #endif  // PACKED_CACHE_ENTRY
+
     unsigned int ply_;
     uint64_t entry_num_;
     Entry* entries_;
 
     #ifdef COLLECT_STATISTICS
-    uint64_t used_entries_;
     uint64_t lookup_count_;
     uint64_t collision_count_;
     uint64_t hit_count_;
@@ -1,7 +0,0 @@
-// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
-
-#include "cell_set.h"
-
-namespace asparagus {
-
-}  // namespace asparagus
@@ -10,7 +10,12 @@ namespace asparagus {
 #define COLLECT_STATISTICS      1
 #define AGGREGATED_STATISTICS   1
 #define USE_CACHE               1
+#define USE_EVAL_CACHE          1
+#define PACKED_CACHE_ENTRY      1
 #define ITERATIVE_DEEPENING     1
+#define FORCED_MOVES            1
+#define USE_TRACER              1
+#define USE_SEARCH_RECORDER     1
 
 #define DISALLOW_COPY_AND_ASSIGN(clazz) \
     clazz(const clazz&) = delete;       \
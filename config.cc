@@ -2,32 +2,203 @@
 
 #include "config.h"
 
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+#include "move_stack.h"
+
 namespace asparagus {
 
 Config::Config()
     :   use_gomocup_protocol_(false),
         cache_size_(100ull * 1024ull * 1024ull),
+        eval_cache_size_(1024ull * 1024ull),
         is_exact_five_(false),
-        max_depth_(5) {}
+        is_renju_(false),
+        max_depth_(5),
+        max_nodes_(0),
+        quiescence_depth_(8),
+        quiescence_nodes_(1000000),
+        quiescence_threes_(1),
+        time_limit_(0),
+        seed_(0),
+        trace_(false),
+        threads_(0),
+        use_server_(false),
+        session_cache_size_(16),
+        session_time_limit_(10000),
+        perft_depth_(0),
+        perft_distance_(2),
+        perft_check_(false) {}
+
+bool Config::Load(int argc, char **argv, std::string* bad_argument) {
+    // Gomocup managers expect the engine executable to be named pbrain-*.
+    if (argc > 0) {
+        const std::string program = argv[0];
+        const size_t slash = program.find_last_of("/\\");
+        const size_t name = slash == std::string::npos ? 0 : slash + 1;
+        if (program.compare(name, 7, "pbrain-") == 0) {
+            use_gomocup_protocol_ = true;
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const size_t equals = arg.find('=');
+        if (arg == "--gomocup") {
+            use_gomocup_protocol_ = true;
+        } else if (arg.compare(0, 8, "--batch=") == 0) {
+            batch_file_ = arg.substr(8);
+        } else if (arg.compare(0, 10, "--weights=") == 0) {
+            weights_file_ = arg.substr(10);
+        } else if (arg.compare(0, 10, "--network=") == 0) {
+            network_file_ = arg.substr(10);
+        } else if (arg.compare(0, 15, "--solver_table=") == 0) {
+            solver_table_file_ = arg.substr(15);
+        } else if (arg.compare(0, 9, "--worker=") == 0) {
+            worker_address_ = arg.substr(9);
+        } else if (arg.compare(0, 10, "--workers=") == 0) {
+            workers_ = arg.substr(10);
+        } else if (arg.compare(0, 11, "--game_log=") == 0) {
+            game_log_file_ = arg.substr(11);
+        } else if (arg == "--server") {
+            use_server_ = true;
+        } else if (arg.compare(0, 9, "--server=") == 0) {
+            use_server_ = true;
+            server_socket_ = arg.substr(9);
+        } else if (arg.compare(0, 8, "--perft=") == 0) {
+            const std::string numbers = arg.substr(8);
+            const size_t comma = numbers.find(',');
+            bool is_valid = ParseNumber(numbers.substr(0, comma), &perft_depth_);
+            if (comma != std::string::npos) {
+                is_valid = is_valid && ParseNumber(numbers.substr(comma + 1), &perft_distance_);
+            }
+            // The plies of the count are kept on the move stack.
+            if (!is_valid || perft_depth_ < 0 || perft_depth_ >= MoveStack::kMaxPlies || perft_distance_ < 1) {
+                if (bad_argument) {
+                    *bad_argument = arg;
+                }
+                return false;
+            }
+        } else if (arg == "--perft_check") {
+            perft_check_ = true;
+        } else if (arg.compare(0, 2, "--") == 0 && equals != std::string::npos) {
+            int value;
+            if (!ParseNumber(arg.substr(equals + 1), &value)) {
+                if (bad_argument) {
+                    *bad_argument = arg;
+                }
+                return false;
+            }
+            Set(arg.substr(2, equals - 2), value);
+        }
+    }
+    return true;
+}
 
-void Config::Load(int argc, char **argv) {
-    // TODO(gyorgy): Implement it.
+// Surrounding white space is allowed, the way sscanf and std::stoi take it.
+static bool IsNumberEnd(const char* text, const char* end) {
+    if (end == text) {
+        return false;
+    }
+    while (isspace(static_cast<unsigned char>(*end))) {
+        end++;
+    }
+    return *end == '\0';
+}
+
+bool Config::ParseNumber(const std::string& text, int* value) {
+    char* end;
+    errno = 0;
+    const long number = strtol(text.c_str(), &end, 10);
+    if (!IsNumberEnd(text.c_str(), end) || errno == ERANGE || number < INT_MIN || number > INT_MAX) {
+        return false;
+    }
+    *value = static_cast<int>(number);
+    return true;
+}
+
+bool Config::ParseNumber(const std::string& text, uint64_t* value) {
+    if (text.find('-') != std::string::npos) {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    const unsigned long long number = strtoull(text.c_str(), &end, 10);
+    if (!IsNumberEnd(text.c_str(), end) || errno == ERANGE) {
+        return false;
+    }
+    *value = number;
+    return true;
 }
 
 int Config::Get(const std::string& key) const {
-    if (key == "is_exact_five") {
+    if (key == "cache_size") {
+        return static_cast<int>(cache_size_ >> 20u);
+    } else if (key == "eval_cache_size") {
+        return static_cast<int>(eval_cache_size_ >> 10u);
+    } else if (key == "is_exact_five") {
         return is_exact_five_ ? 1 : 0;
+    } else if (key == "renju") {
+        return is_renju_ ? 1 : 0;
     } else if (key == "max_depth") {
         return max_depth_;
+    } else if (key == "max_nodes") {
+        return max_nodes_;
+    } else if (key == "quiescence_depth") {
+        return quiescence_depth_;
+    } else if (key == "quiescence_nodes") {
+        return quiescence_nodes_;
+    } else if (key == "quiescence_threes") {
+        return quiescence_threes_;
+    } else if (key == "time_limit") {
+        return time_limit_;
+    } else if (key == "seed") {
+        return seed_;
+    } else if (key == "trace") {
+        return trace_ ? 1 : 0;
+    } else if (key == "threads") {
+        return threads_;
+    } else if (key == "session_cache_size") {
+        return session_cache_size_;
+    } else if (key == "session_time_limit") {
+        return session_time_limit_;
     }
     return 0;
 }
 
 void Config::Set(const std::string& key, int value) {
-    if (key == "is_exact_five") {
+    if (key == "cache_size") {
+        cache_size_ = static_cast<uint64_t>(value) << 20u;
+    } else if (key == "eval_cache_size") {
+        eval_cache_size_ = static_cast<uint64_t>(value) << 10u;
+    } else if (key == "is_exact_five") {
         is_exact_five_ = value;
+    } else if (key == "renju") {
+        is_renju_ = value;
     } else if (key == "max_depth") {
         max_depth_ = value;
+    } else if (key == "max_nodes") {
+        max_nodes_ = value;
+    } else if (key == "quiescence_depth") {
+        quiescence_depth_ = value;
+    } else if (key == "quiescence_nodes") {
+        quiescence_nodes_ = value;
+    } else if (key == "quiescence_threes") {
+        quiescence_threes_ = value;
+    } else if (key == "time_limit") {
+        time_limit_ = value;
+    } else if (key == "seed") {
+        seed_ = value;
+    } else if (key == "trace") {
+        trace_ = value;
+    } else if (key == "threads") {
+        threads_ = value;
+    } else if (key == "session_cache_size") {
+        session_cache_size_ = value;
+    } else if (key == "session_time_limit") {
+        session_time_limit_ = value;
     }
 }
 
@@ -9,26 +9,86 @@
 
 namespace asparagus {
 
+// Configuration values are plain data, the server hands a copy of its own
+// configuration to every session.
 class Config final {
 public:
     Config();
 
     constexpr bool use_gomocup_protocol() const { return use_gomocup_protocol_; }
     constexpr uint64_t cache_size() const { return cache_size_; }
+    constexpr uint64_t eval_cache_size() const { return eval_cache_size_; }
     constexpr bool is_exact_five() const { return is_exact_five_; }
+    constexpr bool is_renju() const { return is_renju_; }
+    // A search ends at the first of its limits, zero nodes or time is unlimited.
+    // Without a time limit the search is repeatable, see seed.
     constexpr int max_depth() const { return max_depth_; }
+    constexpr int max_nodes() const { return max_nodes_; }
+    constexpr int quiescence_depth() const { return quiescence_depth_; }
+    constexpr int quiescence_nodes() const { return quiescence_nodes_; }
+    constexpr int quiescence_threes() const { return quiescence_threes_; }
+    constexpr int time_limit() const { return time_limit_; }
+    // Of the Zobrist keys shared by the process, zero picks a random one.
+    constexpr int seed() const { return seed_; }
+    constexpr bool trace() const { return trace_; }
+    constexpr int threads() const { return threads_; }
+    const std::string& batch_file() const { return batch_file_; }
+    const std::string& weights_file() const { return weights_file_; }
+    const std::string& network_file() const { return network_file_; }
+    const std::string& solver_table_file() const { return solver_table_file_; }
+    const std::string& worker_address() const { return worker_address_; }
+    const std::string& workers() const { return workers_; }
+    const std::string& game_log_file() const { return game_log_file_; }
+    constexpr bool use_server() const { return use_server_; }
+    const std::string& server_socket() const { return server_socket_; }
+    constexpr int session_cache_size() const { return session_cache_size_; }
+    // The longest search of a server session in milliseconds.
+    constexpr int session_time_limit() const { return session_time_limit_; }
+    constexpr int perft_depth() const { return perft_depth_; }
+    constexpr int perft_distance() const { return perft_distance_; }
+    constexpr bool perft_check() const { return perft_check_; }
 
-    void Load(int argc, char** argv);
+    // Returns false on a malformed number, the argument ends up in bad_argument.
+    bool Load(int argc, char** argv, std::string* bad_argument = nullptr);
     int Get(const std::string& key) const;
     void Set(const std::string& key, int value);
+    void set_weights_file(const std::string& path) { weights_file_ = path; }
+    void set_network_file(const std::string& path) { network_file_ = path; }
+
+    // Parse a whole decimal number of the command line or a protocol, unlike
+    // std::stoi they fail on trailing garbage and overflow instead of throwing.
+    static bool ParseNumber(const std::string& text, int* value);
+    static bool ParseNumber(const std::string& text, uint64_t* value);
 
 private:
     bool use_gomocup_protocol_;
     uint64_t cache_size_;
+    uint64_t eval_cache_size_;
     bool is_exact_five_;
+    bool is_renju_;
     int max_depth_;
-
-    DISALLOW_COPY_AND_ASSIGN(Config);
+    int max_nodes_;
+    int quiescence_depth_;
+    int quiescence_nodes_;
+    int quiescence_threes_;
+    int time_limit_;
+    int seed_;
+    bool trace_;
+    int threads_;
+    std::string batch_file_;
+    std::string weights_file_;
+    std::string network_file_;
+    std::string solver_table_file_;
+    std::string worker_address_;
+    std::string workers_;
+    std::string game_log_file_;
+    bool use_server_;
+    std::string server_socket_;
+    int session_cache_size_;
+    int session_time_limit_;
+    int perft_depth_;
+    int perft_distance_;
+    bool perft_check_;
 };
 
 }  // namespace asparagus
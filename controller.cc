@@ -2,6 +2,9 @@
 
 #include "controller.h"
 
+#include <algorithm>
+#include <chrono>
+
 #include "config.h"
 #include "engine.h"
 
@@ -9,43 +12,191 @@ namespace asparagus {
 
 Controller::Controller(const Config& config, Engine* engine)
     :   config_(config),
+        origin_({ 1, 1 }),
+        is_sparse_(false),
         engine_(engine),
-        state_(kUnknown) {}
+        state_(kUnknown),
+        game_log_(nullptr) {}
+
+Controller::~Controller() {
+    if (game_log_) {
+        game_log_->Write(game_);
+    }
+}
 
 void Controller::Start(int width, int height) {
+    StartGame(width, height);
     board_.Initialize(width, height);
+    origin_ = { 1, 1 };
+    is_sparse_ = false;
+    engine_->Start();
+    state_ = kPlaying;
+}
+
+void Controller::ClearBoard() {
+    board_.Initialize(board_.width(), board_.height());
+    game_.result = GameRecord::kUnfinished;
+    game_.moves.clear();
+    state_ = kPlaying;
+}
+
+void Controller::StartSparse(int width, int height) {
+    StartGame(0, 0);
+    sparse_board_.Initialize(width, height);
+    origin_ = sparse_board_.GetWindow(kWindowMargin, &board_);
+    is_sparse_ = true;
     engine_->Start();
     state_ = kPlaying;
 }
 
 void Controller::SetCell(Cell cell, Stone stone) {
     board_.Set(cell, stone);
+    AddMove(cell, stone);
+}
+
+void Controller::SetCell(int32_t x, int32_t y, Stone stone) {
+    sparse_board_.Set(x, y, stone);
+}
+
+bool Controller::IsForbiddenMove(Cell move, Stone stone) {
+    if (is_sparse_) {
+        return false;
+    }
+    UpdateRenju(stone);
+    return board_.black() == stone && board_.IsForbidden(move);
 }
 
 void Controller::PlayerMove(Cell move) {
+    UpdateRenju(kPlayer);
     board_.Set(move, kPlayer);
+    AddMove(move, kPlayer);
     if (board_.IsTerminalMove(move, kPlayer, config_.is_exact_five())) {
         state_ = kWon;
+        game_.result = GameRecord::kPlayerWon;
+    }
+}
+
+void Controller::PlayerMove(int32_t x, int32_t y) {
+    sparse_board_.Set(x, y, kPlayer);
+    if (sparse_board_.IsTerminalMove(x, y, kPlayer, config_.is_exact_five())) {
+        state_ = kWon;
     }
 }
 
-Cell Controller::GetEngineMove() {
-    Cell move = engine_->GetBestMove(&board_);
+Cell Controller::GetEngineMove(const SearchControl* control) {
+    if (is_sparse_) {
+        origin_ = sparse_board_.GetWindow(kWindowMargin, &board_);
+    } else {
+        UpdateRenju(kEngine);
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    Cell move = engine_->GetBestMove(&board_, control);
     if (!GetX(move)) {
         state_ = kDraw;
+        game_.result = GameRecord::kDraw;
+    } else if (is_sparse_) {
+        const SparseBoard::Point point = GetPoint(move);
+        board_.Set(move, kEngine);
+        sparse_board_.Set(point.x, point.y, kEngine);
+        if (sparse_board_.IsTerminalMove(point.x, point.y, kEngine, config_.is_exact_five())) {
+            state_ = kWon;
+        }
     } else {
+        const SearchInfo& info = engine_->last_info();
+        const auto time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
         board_.Set(move, kEngine);
+        if (GameMove* record = AddMove(move, kEngine)) {
+            record->is_searched = true;
+            record->depth = static_cast<uint8_t>(info.depth);
+            record->score = info.score;
+            record->nodes = info.nodes;
+            record->time_us = static_cast<uint32_t>(std::min<int64_t>(time_us, UINT32_MAX));
+        }
         if (board_.IsTerminalMove(move, kEngine, config_.is_exact_five())) {
             state_ = kWon;
+            game_.result = GameRecord::kEngineWon;
         }
     }
     return move;
 }
 
+SparseBoard::Point Controller::GetPoint(Cell cell) const {
+    return { origin_.x + static_cast<int32_t>(GetX(cell)) - 1,
+             origin_.y + static_cast<int32_t>(GetY(cell)) - 1 };
+}
+
+void Controller::UpdateRenju(Stone to_move) {
+    if (!config_.is_renju()) {
+        if (board_.black()) {
+            board_.SetRenju(kEmpty);
+        }
+        return;
+    }
+    if (board_.black()) {
+        return;
+    }
+    // Black moves first, so it is to move whenever the stone counts are equal.
+    int engine_stones = 0;
+    int player_stones = 0;
+    for (int y = 1; y <= board_.height(); y++) {
+        for (int x = 1; x <= board_.width(); x++) {
+            const Stone stone = board_.stone(MakeCell(x, y));
+            engine_stones += stone == kEngine;
+            player_stones += stone == kPlayer;
+        }
+    }
+    const Stone other = to_move == kEngine ? kPlayer : kEngine;
+    board_.SetRenju(engine_stones == player_stones ? to_move : other);
+}
+
+void Controller::StartGame(int width, int height) {
+    if (game_log_) {
+        game_log_->Write(game_);
+    }
+    game_.width = width;
+    game_.height = height;
+    game_.is_exact_five = config_.is_exact_five();
+    game_.is_renju = config_.is_renju();
+    game_.result = GameRecord::kUnfinished;
+    game_.moves.clear();
+}
+
+GameMove* Controller::AddMove(Cell cell, Stone stone) {
+    if (is_sparse_ || !game_.width) {
+        return nullptr;
+    }
+    game_.moves.push_back({ cell, stone, false, 0, 0, 0, 0 });
+    return &game_.moves.back();
+}
+
 #ifdef COLLECT_STATISTICS
 void Controller::PrintStats(std::ostream& out) {
     engine_->PrintStats(out);
 }
+
+void Controller::WriteLatencyJson(std::ostream& out) {
+    engine_->WriteLatencyJson(out);
+}
 #endif  // COLLECT_STATISTICS
 
+#ifdef USE_TRACER
+void Controller::DumpTrace(std::ostream& out, bool clear) {
+    engine_->tracer()->Dump(out);
+    if (clear) {
+        engine_->tracer()->Clear();
+    }
+}
+#endif  // USE_TRACER
+
+#ifdef USE_SEARCH_RECORDER
+bool Controller::RecordSearch(const std::string& path, uint64_t max_nodes, int max_ply) {
+    return engine_->recorder()->Arm(path, max_nodes, max_ply);
+}
+
+void Controller::CancelRecording() {
+    engine_->recorder()->Disarm();
+}
+#endif  // USE_SEARCH_RECORDER
+
 }  // namespace asparagus
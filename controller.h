@@ -5,38 +5,85 @@
 
 #include "board.h"
 #include "common.h"
+#include "game_log.h"
+#include "sparse_board.h"
 
-#ifdef COLLECT_STATISTICS
+#if defined(COLLECT_STATISTICS) || defined(USE_TRACER)
 #include <ostream>
-#endif  // COLLECT_STATISTICS
+#endif  // COLLECT_STATISTICS || USE_TRACER
 
 namespace asparagus {
 
 class Config;
 class Engine;
+struct SearchControl;
 
 class Controller {
 public:
     enum State { kUnknown, kPlaying, kWon, kDraw };
 
     Controller(const Config& config, Engine* engine);
+    // Logs the game in progress.
+    ~Controller();
 
     constexpr State state() const { return state_; }
     constexpr const Board& board() const { return board_; }
+    constexpr bool is_sparse() const { return is_sparse_; }
+    constexpr const SparseBoard& sparse_board() const { return sparse_board_; }
+    constexpr const GameRecord& game() const { return game_; }
+
+    // Games end up in the log when the next one starts or the controller goes
+    // away. Sparse games are not logged.
+    void set_game_log(GameLog* game_log) { game_log_ = game_log; }
 
     void Start(int width, int height);
+    // Takes the stones off the dense board of the game in progress, the engine keeps
+    // its cache for the position set up next.
+    void ClearBoard();
+    // Starts a freestyle game on a sparse board, zero sizes make it infinite.
+    // The engine searches a window of it, board() holds the last window.
+    void StartSparse(int width, int height);
     void SetCell(Cell cell, Stone stone);
+    void SetCell(int32_t x, int32_t y, Stone stone);
     void PlayerMove(Cell move);
-    Cell GetEngineMove();
+    void PlayerMove(int32_t x, int32_t y);
+    // Tells whether the Renju restrictions forbid the move for the given side.
+    bool IsForbiddenMove(Cell move, Stone stone);
+    Cell GetEngineMove(const SearchControl* control = nullptr);
+    // The coordinates of the game for a cell of board().
+    SparseBoard::Point GetPoint(Cell cell) const;
     #ifdef COLLECT_STATISTICS
     void PrintStats(std::ostream& out);
+    void WriteLatencyJson(std::ostream& out);
     #endif  // COLLECT_STATISTICS
+    #ifdef USE_TRACER
+    void DumpTrace(std::ostream& out, bool clear);
+    #endif  // USE_TRACER
+    #ifdef USE_SEARCH_RECORDER
+    // Records the tree of the next engine move into the file, see SearchRecorder.
+    bool RecordSearch(const std::string& path, uint64_t max_nodes, int max_ply);
+    void CancelRecording();
+    #endif  // USE_SEARCH_RECORDER
 
 private:
+    // Empty cells kept around the stones in the searched window.
+    static constexpr int kWindowMargin = 5;
+
     const Config& config_;
     Board board_;
+    SparseBoard sparse_board_;
+    SparseBoard::Point origin_;
+    bool is_sparse_;
     Engine* engine_;
     State state_;
+    GameLog* game_log_;
+    GameRecord game_;
+
+    // Under Renju the side that moves first on the board plays black.
+    void UpdateRenju(Stone to_move);
+    void StartGame(int width, int height);
+    // Returns the move added to the game, nullptr if the game is not recorded.
+    GameMove* AddMove(Cell cell, Stone stone);
 
     DISALLOW_COPY_AND_ASSIGN(Controller);
 };
@@ -0,0 +1,469 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "distributed.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "board.h"
+#include "config.h"
+#include "engine.h"
+#include "position_stream.h"
+
+namespace asparagus {
+
+// Messages are a 4 byte length followed by the payload, numbers are little
+// endian. A job is
+//   'J', depth (1), alpha (4), beta (4), time limit (4), black (1), move (2),
+//   root record size (4), root record, line,
+// the record is the position before the move with the engine to move, alpha
+// and beta are from the side to move after the move. The time limit is in
+// milliseconds, zero for none. A result is
+//   'R', done (1), value (4), nodes (8), line,
+// where done is zero if the job ran out of time and its value is not known,
+// and a line is its length (2) and the entries, each of them
+//   type (1), depth (1), value (4), best move (2).
+// Values are signed integers, the window and the value of a job count the
+// plies of wins from the position after the move.
+constexpr uint8_t kJobMessage = 'J';
+constexpr uint8_t kResultMessage = 'R';
+constexpr uint32_t kMaxMessageSize = 1u << 20u;
+
+class MessageWriter final {
+public:
+    std::vector<uint8_t>& data() { return data_; }
+
+    void Put(uint64_t value, int size) {
+        for (int i = 0; i < size; i++) {
+            data_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+    void PutScore(Score value) {
+        Put(static_cast<uint32_t>(value), 4);
+    }
+    void PutLine(const std::vector<LineEntry>& line) {
+        Put(line.size(), 2);
+        for (auto& entry : line) {
+            Put(entry.type, 1);
+            Put(entry.depth, 1);
+            PutScore(entry.value);
+            Put(entry.best_move, 2);
+        }
+    }
+
+private:
+    std::vector<uint8_t> data_;
+};
+
+class MessageReader final {
+public:
+    explicit MessageReader(const std::vector<uint8_t>& data) : data_(data), offset_(0), is_valid_(true) {}
+
+    constexpr bool is_valid() const { return is_valid_; }
+
+    uint64_t Get(int size) {
+        if (offset_ + size > data_.size()) {
+            is_valid_ = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < size; i++) {
+            value |= static_cast<uint64_t>(data_[offset_++]) << (8 * i);
+        }
+        return value;
+    }
+    Score GetScore() {
+        return static_cast<Score>(static_cast<uint32_t>(Get(4)));
+    }
+    const uint8_t* GetBytes(size_t size) {
+        if (offset_ + size > data_.size()) {
+            is_valid_ = false;
+            return nullptr;
+        }
+        offset_ += size;
+        return data_.data() + offset_ - size;
+    }
+    void GetLine(std::vector<LineEntry>* line) {
+        const int size = static_cast<int>(Get(2));
+        for (int i = 0; i < size && is_valid_; i++) {
+            LineEntry entry;
+            entry.type = static_cast<uint8_t>(Get(1));
+            entry.depth = static_cast<uint8_t>(Get(1));
+            entry.value = GetScore();
+            entry.best_move = static_cast<Cell>(Get(2));
+            line->push_back(entry);
+        }
+    }
+
+private:
+    const std::vector<uint8_t>& data_;
+    size_t offset_;
+    bool is_valid_;
+};
+
+static bool SendMessage(int fd, const std::vector<uint8_t>& payload) {
+    MessageWriter header;
+    header.Put(payload.size(), 4);
+    std::vector<uint8_t> message = header.data();
+    message.insert(message.end(), payload.begin(), payload.end());
+    for (size_t sent = 0; sent < message.size();) {
+        const ssize_t count = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0) {
+            return false;
+        }
+        sent += count;
+    }
+    return true;
+}
+
+static bool ReceiveBytes(int fd, uint8_t* data, size_t size) {
+    for (size_t received = 0; received < size;) {
+        const ssize_t count = recv(fd, data + received, size - received, 0);
+        if (count <= 0) {
+            return false;
+        }
+        received += count;
+    }
+    return true;
+}
+
+static bool ReceiveMessage(int fd, std::vector<uint8_t>* payload) {
+    uint8_t header[4];
+    if (!ReceiveBytes(fd, header, sizeof(header))) {
+        return false;
+    }
+    const uint32_t size = header[0] | header[1] << 8u | header[2] << 16u |
+                          static_cast<uint32_t>(header[3]) << 24u;
+    if (size > kMaxMessageSize) {
+        return false;
+    }
+    payload->resize(size);
+    return ReceiveBytes(fd, payload->data(), size);
+}
+
+static bool IsUnixAddress(const std::string& address) {
+    return address.find('/') != std::string::npos;
+}
+
+static addrinfo* ResolveAddress(const std::string& address, bool is_passive) {
+    const size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        return nullptr;
+    }
+    const std::string host = address.substr(0, colon);
+    const std::string port = address.substr(colon + 1);
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = is_passive ? AI_PASSIVE : 0;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result)) {
+        return nullptr;
+    }
+    return result;
+}
+
+static int ListenSocket(const std::string& address) {
+    if (IsUnixAddress(address)) {
+        sockaddr_un unix_address;
+        if (address.size() >= sizeof(unix_address.sun_path)) {
+            return -1;
+        }
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        memset(&unix_address, 0, sizeof(unix_address));
+        unix_address.sun_family = AF_UNIX;
+        strcpy(unix_address.sun_path, address.c_str());
+        unlink(address.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&unix_address), sizeof(unix_address)) ||
+            listen(fd, SOMAXCONN)) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    addrinfo* addresses = ResolveAddress(address, true);
+    int fd = -1;
+    for (addrinfo* it = addresses; it && fd < 0; it = it->ai_next) {
+        fd = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        const int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(fd, it->ai_addr, it->ai_addrlen) || listen(fd, SOMAXCONN)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (addresses) {
+        freeaddrinfo(addresses);
+    }
+    return fd;
+}
+
+static int ConnectSocket(const std::string& address) {
+    if (IsUnixAddress(address)) {
+        sockaddr_un unix_address;
+        if (address.size() >= sizeof(unix_address.sun_path)) {
+            return -1;
+        }
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        memset(&unix_address, 0, sizeof(unix_address));
+        unix_address.sun_family = AF_UNIX;
+        strcpy(unix_address.sun_path, address.c_str());
+        if (connect(fd, reinterpret_cast<sockaddr*>(&unix_address), sizeof(unix_address))) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    addrinfo* addresses = ResolveAddress(address, false);
+    int fd = -1;
+    for (addrinfo* it = addresses; it && fd < 0; it = it->ai_next) {
+        fd = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+        if (fd >= 0 && connect(fd, it->ai_addr, it->ai_addrlen)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (addresses) {
+        freeaddrinfo(addresses);
+    }
+    if (fd >= 0) {
+        // Messages are small and answered one by one.
+        const int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    }
+    return fd;
+}
+
+static Stone GetOpponent(Stone stone) {
+    return stone == kEngine ? kPlayer : stone == kPlayer ? kEngine : stone;
+}
+
+Worker::Worker(const Config& config)
+    :   config_(config) {}
+
+bool Worker::Run(const std::string& address) {
+    const int fd = ListenSocket(address);
+    if (fd < 0) {
+        return false;
+    }
+    for (;;) {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client >= 0) {
+            std::thread(&Worker::Serve, this, client).detach();
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    close(fd);
+    return false;
+}
+
+void Worker::Serve(int fd) {
+    {
+        Engine engine(config_);
+        engine.Start();
+        Board board;
+        std::vector<uint8_t> payload;
+        while (ReceiveMessage(fd, &payload)) {
+            MessageReader reader(payload);
+            if (reader.Get(1) != kJobMessage) {
+                break;
+            }
+            const int depth = static_cast<int>(reader.Get(1));
+            const Score alpha = reader.GetScore();
+            const Score beta = reader.GetScore();
+            const int time_limit = static_cast<int>(reader.Get(4));
+            const Stone black = static_cast<Stone>(reader.Get(1));
+            const Cell move = static_cast<Cell>(reader.Get(2));
+            const size_t record_size = reader.Get(4);
+            const uint8_t* record = reader.GetBytes(record_size);
+            std::vector<LineEntry> line;
+            reader.GetLine(&line);
+            Stone to_move;
+            if (!reader.is_valid() || !PositionStream::Decode(record, record_size, &board, &to_move) ||
+                !board.IsEmptyCell(move)) {
+                break;
+            }
+            // The stones index the hash keys, a job from the network is not trusted.
+            if ((to_move != kEngine && to_move != kPlayer) ||
+                (black != kEmpty && black != kEngine && black != kPlayer)) {
+                break;
+            }
+            // The engine searches for the O stones, the colours are swapped so
+            // that the side to move after the move plays them.
+            board.Set(move, to_move);
+            if (to_move == kEngine) {
+                for (int y = 1; y <= board.height(); y++) {
+                    for (int x = 1; x <= board.width(); x++) {
+                        const Cell cell = MakeCell(x, y);
+                        board.Set(cell, GetOpponent(board.stone(cell)));
+                    }
+                }
+            }
+            board.SetRenju(to_move == kEngine ? GetOpponent(black) : black);
+            engine.ImportLine(&board, kEngine, line);
+
+            uint64_t nodes = 0;
+            Score value = 0;
+            const bool is_done = engine.SearchWindow(&board, depth, alpha, beta, time_limit, &value, &nodes);
+            line.clear();
+            engine.ExportLine(&board, kEngine, depth, &line);
+
+            MessageWriter writer;
+            writer.Put(kResultMessage, 1);
+            writer.Put(is_done, 1);
+            writer.PutScore(value);
+            writer.Put(nodes, 8);
+            writer.PutLine(line);
+            if (!SendMessage(fd, writer.data())) {
+                break;
+            }
+        }
+    }
+    close(fd);
+}
+
+Coordinator::Coordinator(const std::string& addresses) {
+    std::istringstream in(addresses);
+    std::string address;
+    while (std::getline(in, address, ',')) {
+        if (!address.empty()) {
+            connections_.push_back({ address, -1 });
+        }
+    }
+}
+
+Coordinator::~Coordinator() {
+    for (auto& connection : connections_) {
+        if (connection.fd >= 0) {
+            close(connection.fd);
+        }
+    }
+}
+
+int Coordinator::Connect() {
+    int count = 0;
+    for (auto& connection : connections_) {
+        if (connection.fd < 0) {
+            connection.fd = ConnectSocket(connection.address);
+        }
+        count += connection.fd >= 0;
+    }
+    return count;
+}
+
+bool Coordinator::Search(const Board& board, int depth, const std::vector<Job>& jobs,
+                         const std::function<bool()>& should_stop,
+                         const std::chrono::steady_clock::time_point* deadline, std::vector<Result>* results) {
+    results->assign(jobs.size(), Result());
+    if (!Connect()) {
+        return false;
+    }
+    std::vector<uint8_t> record;
+    PositionStream::Encode(board, kEngine, &record);
+
+    std::mutex mutex;
+    std::vector<size_t> pending;
+    for (size_t i = jobs.size(); i > 0; i--) {
+        pending.push_back(i - 1);
+    }
+    Score best_value = -kInfinity;
+    auto work = [&](Connection* connection) {
+        for (;;) {
+            size_t index;
+            Score alpha;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending.empty() || should_stop()) {
+                    return;
+                }
+                index = pending.back();
+                pending.pop_back();
+                alpha = best_value;
+            }
+            const Job& job = jobs[index];
+            // A job sent just before the deadline still gets a millisecond.
+            int time_limit = 0;
+            if (deadline) {
+                const auto time_left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    *deadline - std::chrono::steady_clock::now()).count();
+                time_limit = static_cast<int>(std::max<int64_t>(time_left, 1));
+            }
+            MessageWriter writer;
+            writer.Put(kJobMessage, 1);
+            writer.Put(depth, 1);
+            // The worker counts the plies of wins from the position after the move.
+            writer.PutScore(-kInfinity);
+            writer.PutScore(ToNodeScore(-alpha, 1));
+            writer.Put(time_limit, 4);
+            writer.Put(board.black(), 1);
+            writer.Put(job.move, 2);
+            writer.Put(record.size(), 4);
+            writer.data().insert(writer.data().end(), record.begin(), record.end());
+            writer.PutLine(job.line);
+
+            std::vector<uint8_t> payload;
+            Result result;
+            bool is_done = false;
+            bool is_valid = SendMessage(connection->fd, writer.data()) &&
+                            ReceiveMessage(connection->fd, &payload);
+            if (is_valid) {
+                MessageReader reader(payload);
+                is_valid = reader.Get(1) == kResultMessage;
+                is_done = reader.Get(1) != 0;
+                result.value = -FromNodeScore(reader.GetScore(), 1);
+                result.nodes = reader.Get(8);
+                reader.GetLine(&result.line);
+                is_valid = is_valid && reader.is_valid();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!is_valid) {
+                // The job is handed to the remaining connections.
+                pending.push_back(index);
+                close(connection->fd);
+                connection->fd = -1;
+                return;
+            }
+            if (!is_done) {
+                continue;
+            }
+            result.is_done = true;
+            best_value = std::max(best_value, result.value);
+            (*results)[index] = std::move(result);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (auto& connection : connections_) {
+        if (connection.fd >= 0) {
+            threads.emplace_back(work, &connection);
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return true;
+}
+
+}  // namespace asparagus
@@ -0,0 +1,99 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_DISTRIBUTED_H
+#define ASPARAGUS_DISTRIBUTED_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "score.h"
+
+namespace asparagus {
+
+class Board;
+class Config;
+
+// Addresses are paths of Unix domain sockets when they contain a '/', and
+// "<host>:<port>" TCP addresses otherwise.
+
+// An entry of the transposition table on a line of best moves. Every process
+// has its own Zobrist keys, so entries travel with the moves that lead to them
+// from the searched position: the first entry is of the position itself, the
+// next one of the position after its best move and so on. Values are from the
+// side to move, as the cache keeps them.
+struct LineEntry {
+    uint8_t type;
+    uint8_t depth;
+    Score value;
+    Cell best_move;
+};
+
+// Serves remote searches, every connection gets an Engine of its own which
+// keeps its transposition table from job to job.
+class Worker final {
+public:
+    explicit Worker(const Config& config);
+
+    // Only returns if the socket cannot be set up.
+    bool Run(const std::string& address);
+
+private:
+    const Config& config_;
+
+    void Serve(int fd);
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+// Splits the root moves of a search between workers. Every connection takes
+// the next move when its last one is done, and searches it with the window of
+// the best value found so far.
+class Coordinator final {
+public:
+    struct Job {
+        Cell move;
+        // The line of the position after the move known to the coordinator.
+        std::vector<LineEntry> line;
+    };
+
+    struct Result {
+        bool is_done = false;
+        // From the side moving at the root.
+        Score value = 0;
+        uint64_t nodes = 0;
+        // The line of the position after the move found by the worker.
+        std::vector<LineEntry> line;
+    };
+
+    explicit Coordinator(const std::string& addresses);
+    ~Coordinator();
+
+    // Searches the positions after the moves of the engine to the given depth.
+    // Jobs of a failed connection go to the others, results of jobs that no
+    // worker could finish, were not started before should_stop or ran out of
+    // time on the worker are not done. Every job gets the time left until the
+    // optional deadline. Returns false if no worker could be reached.
+    bool Search(const Board& board, int depth, const std::vector<Job>& jobs,
+                const std::function<bool()>& should_stop,
+                const std::chrono::steady_clock::time_point* deadline, std::vector<Result>* results);
+
+private:
+    struct Connection {
+        std::string address;
+        int fd;
+    };
+
+    std::vector<Connection> connections_;
+
+    // Reconnects the workers lost or never reached.
+    int Connect();
+
+    DISALLOW_COPY_AND_ASSIGN(Coordinator);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_DISTRIBUTED_H
@@ -2,28 +2,72 @@
 
 #include "engine.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "board.h"
-#include "cell_set.h"
 #include "config.h"
+#include "distributed.h"
+#include "network.h"
+#include "solver.h"
+#include "weights.h"
 
 
 namespace asparagus {
 
-constexpr float kInfinity = std::numeric_limits<float>::infinity();
-constexpr float kWinValue = 1e20f;
+constexpr int32_t kCachedMoveScore = 1 << 30;
+
+constexpr int Engine::kMaxSearchDepth;
+
+// Falls back to the built in weights if the weights file cannot be loaded.
+static const Patterns& GetPatterns(const Config& config) {
+    const Patterns* patterns = Weights::GetPatterns(config.weights_file());
+    return patterns ? *patterns : *Weights::GetPatterns("");
+}
 
 Engine::Engine(const Config &config)
+    :   Engine(config, config.cache_size()) {}
+
+Engine::Engine(const Config &config, uint64_t cache_size)
     :   config_(config),
-        cache_(config.cache_size()) {
-    for (const Pattern* pattern = kPatterns; pattern->pattern_; pattern++) {
-        patterns_.AddPattern(pattern->pattern_, pattern->value_);
-    }
-}
+        evaluator_(GetPatterns(config)),
+        network_(config.network_file().empty() ? nullptr : Network::Get(config.network_file())),
+        accumulator_(network_ ? new NetworkAccumulator(network_) : nullptr),
+        solver_table_(config.solver_table_file().empty() ?
+                      nullptr : SolverTable::Get(config.solver_table_file())),
+        coordinator_(config.workers().empty() ? nullptr : new Coordinator(config.workers())),
+        cache_(cache_size),
+        #ifdef USE_EVAL_CACHE
+        eval_cache_(config.eval_cache_size()),
+        #endif  // USE_EVAL_CACHE
+        stop_(nullptr),
+        is_time_limited_(false),
+        max_nodes_(0),
+        is_aborted_(false),
+        searched_nodes_(0),
+        quiescence_nodes_(0),
+        quiescence_limit_(0) {}
+
+Engine::~Engine() = default;
 
 void Engine::Start() {
+    #ifdef USE_TRACER
+    tracer_.Enable(config_.trace());
+    #endif  // USE_TRACER
     #ifdef USE_CACHE
-    cache_.Reset();
+    {
+        #ifdef USE_TRACER
+        Tracer::Span span(&tracer_, "cache reset");
+        #endif  // USE_TRACER
+        cache_.Reset();
+    }
     #endif  // USE_CACHE
+    #ifdef USE_EVAL_CACHE
+    eval_cache_.Reset();
+    #endif  // USE_EVAL_CACHE
+    #ifdef COLLECT_STATISTICS
+    game_latency_.Reset();
+    #endif  // COLLECT_STATISTICS
     #ifdef AGGREGATED_STATISTICS
     aggregated_node_count_ = 0;
     aggregated_eval_count_ = 0;
@@ -31,30 +75,108 @@ void Engine::Start() {
     #endif  // AGGREGATED_STATISTICS
 }
 
-Cell Engine::GetBestMove(Board* board) {
+Cell Engine::GetBestMove(Board* board, const SearchControl* control) {
+    #ifdef USE_TRACER
+    tracer_.Enable(config_.trace());
+    Tracer::Span span(&tracer_, "search", config_.max_depth());
+    #endif  // USE_TRACER
     #ifdef COLLECT_STATISTICS
     start_time_ = std::chrono::steady_clock::now();
     node_count_ = 0;
     eval_count_ = 0;
     cutoff_count_ = 0;
     #endif  // COLLECT_STATISTICS
+    const bool is_infinite = control && control->is_infinite;
+    const auto start_time = std::chrono::steady_clock::now();
+    stop_ = control ? control->stop : nullptr;
+    int time_limit = is_infinite ? 0 : config_.time_limit();
+    if (control && control->max_time > 0 && (time_limit <= 0 || time_limit > control->max_time)) {
+        time_limit = control->max_time;
+    }
+    is_time_limited_ = time_limit > 0;
+    deadline_ = start_time + std::chrono::milliseconds(time_limit);
+    max_nodes_ = is_infinite ? 0 : static_cast<uint64_t>(std::max(config_.max_nodes(), 0));
+    is_aborted_ = false;
+    searched_nodes_ = 0;
+    quiescence_nodes_ = 0;
+    last_info_ = SearchInfo();
     cache_.NewSearch();
+    #ifdef USE_SEARCH_RECORDER
+    recorder_.Begin();
+    #endif  // USE_SEARCH_RECORDER
+    board->Attach(accumulator_.get());
     Cell best_move = MakeCell(0, 0);
-    if (board->empty()) {
+    if (solver_table_ && solver_table_->Matches(*board, config_.is_exact_five())) {
+        best_move = Solver::GetMove(*solver_table_, *board, kEngine);
+    }
+    if (GetX(best_move)) {
+        last_info_.pv.push_back(best_move);
+    } else if (board->empty()) {
         best_move = MakeCell(board->width() / 2, board->height() / 2);
+        last_info_.pv.push_back(best_move);
     } else {
+        // The depth is limited by the plies of the move stack.
+        const int max_depth = is_infinite ? kMaxSearchDepth : std::min(config_.max_depth(), kMaxSearchDepth);
         #ifdef ITERATIVE_DEEPENING
-        for (int depth = 1; depth <= config_.max_depth(); depth++) {
-            NegaMax(board, depth, -kInfinity, kInfinity, 1.0f, 2, &best_move);
+        for (int depth = 1; depth <= max_depth; depth++) {
+            #ifdef USE_TRACER
+            Tracer::Span iteration_span(&tracer_, "iteration", depth);
+            #endif  // USE_TRACER
+            Cell move = MakeCell(0, 0);
+            StartIteration();
+            const Score value = coordinator_ ? SearchRemote(board, depth, &move) :
+                                SearchRoot(board, depth, -kInfinity, kInfinity, 2, &move);
+            // An aborted iteration only reports the best of the root moves it could
+            // finish, which is used when no earlier iteration is available.
+            if (!is_aborted_ || !GetX(best_move)) {
+                best_move = move;
+            }
+            if (is_aborted_) {
+                break;
+            }
+            const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+            last_info_.depth = depth;
+            last_info_.score = value;
+            last_info_.nodes = searched_nodes_;
+            last_info_.time = duration.count();
+            last_info_.pv.clear();
+            GetPrincipalVariation(board, move, depth, &last_info_.pv);
+            if (control && control->on_iteration) {
+                control->on_iteration(last_info_);
+            }
         }
         #else  // ITERATIVE_DEEPENING
-        NegaMax(board, config_.max_depth(), -kInfinity, kInfinity, 1.0f, 2, &best_move);
+        StartIteration();
+        last_info_.depth = max_depth;
+        last_info_.score = coordinator_ ? SearchRemote(board, max_depth, &best_move) :
+                           SearchRoot(board, max_depth, -kInfinity, kInfinity, 2, &best_move);
+        last_info_.nodes = searched_nodes_;
+        GetPrincipalVariation(board, best_move, max_depth, &last_info_.pv);
         #endif  // ITERATIVE_DEEPENING
+        if (!GetX(best_move)) {
+            MoveList* moves = move_stack_.moves(0);
+            board->GetPossibleMoves(2, move_stack_.marker(), moves);
+            for (auto& move : *moves) {
+                if (board->black() != kEngine || !board->IsForbidden(move.cell)) {
+                    best_move = move.cell;
+                    break;
+                }
+            }
+        }
     }
+    stop_ = nullptr;
+    board->Attach(nullptr);
+    #ifdef USE_SEARCH_RECORDER
+    recorder_.End();
+    #endif  // USE_SEARCH_RECORDER
     #ifdef COLLECT_STATISTICS
     auto end_time = std::chrono::steady_clock::now();
     std::chrono::duration<double> duration = end_time - start_time_;
     thinkig_time_ = duration.count();
+    const uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    game_latency_.Record(latency, *board);
+    session_latency_.Record(latency, *board);
+    LatencyStats::process()->Record(latency, *board);
     #ifdef AGGREGATED_STATISTICS
     aggregated_node_count_ += node_count_;
     aggregated_eval_count_ += eval_count_;
@@ -71,11 +193,15 @@ void Engine::PrintStats(std::ostream& out) {
     out << " thinking time: " << thinkig_time_ << std::endl;
     out << " nodes        : " << node_count_ << std::endl;
     out << " evals        : " << eval_count_ << std::endl;
+    out << " quiescence   : " << quiescence_nodes_ << std::endl;
     out << " cutoff rate  : " << 100.0 * double(cutoff_count_) / double(node_count_) << std::endl;
     out << " nodes/sec    : " << double(node_count_) / thinkig_time_ << std::endl;
     out << " evals/sec    : " << double(eval_count_) / thinkig_time_ << std::endl;
     out << std::endl;
     cache_.PrintStats(out);
+    #ifdef USE_EVAL_CACHE
+    eval_cache_.PrintStats(out);
+    #endif  // USE_EVAL_CACHE
 
     #ifdef AGGREGATED_STATISTICS
     out << "aggregated stats:" << std::endl;
@@ -83,59 +209,300 @@ void Engine::PrintStats(std::ostream& out) {
     out << " eval rate   : " << 100.0 * double(aggregated_eval_count_) / double(aggregated_node_count_) << std::endl;
     out << " cutoff rate : " << 100.0 * double(aggregated_cutoff_count_) / double(aggregated_node_count_) << std::endl;
     #endif  // AGGREGATED_STATISCTICS
+    out << std::endl;
+
+    out << "latency (us):" << std::endl;
+    game_latency_.PrintSummary(out, "game");
+    session_latency_.PrintSummary(out, "session");
+    LatencyStats::process()->PrintSummary(out, "process");
+}
+
+void Engine::WriteLatencyJson(std::ostream& out) {
+    out << "{\"game\":";
+    game_latency_.WriteJson(out);
+    out << ",\"session\":";
+    session_latency_.WriteJson(out);
+    out << ",\"process\":";
+    LatencyStats::process()->WriteJson(out);
+    out << "}";
 }
 #endif  // COLLECT_STATISTICS
 
-float Engine::NegaMax(Board* node, int depth, float alpha, float beta, float color, int distance,
-                      Cell* best_move) {
+bool Engine::SearchWindow(Board* board, int depth, Score alpha, Score beta, int time_limit,
+                          Score* value, uint64_t* nodes) {
+    stop_ = nullptr;
+    is_time_limited_ = time_limit > 0;
+    deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_limit);
+    max_nodes_ = 0;
+    is_aborted_ = false;
+    searched_nodes_ = 0;
+    quiescence_nodes_ = 0;
+    cache_.NewSearch();
+    board->Attach(accumulator_.get());
+    // The shallow iterations order the moves of the deeper ones through the cache.
+    Cell move = MakeCell(0, 0);
+    depth = std::min(depth, kMaxSearchDepth);
+    for (int current = depth > 0 ? 1 : 0; current <= depth && !is_aborted_; current++) {
+        StartIteration();
+        *value = SearchRoot(board, current, alpha, beta, 1, &move);
+    }
+    board->Attach(nullptr);
+    *nodes = searched_nodes_;
+    is_time_limited_ = false;
+    return !is_aborted_;
+}
+
+void Engine::ExportLine(Board* board, Stone stone, int max_length, std::vector<LineEntry>* line) {
+    #ifdef USE_CACHE
+    std::vector<Cell> played;
+    while (static_cast<int>(line->size()) < max_length) {
+        const Cache::Entry* entry = cache_.Probe(board->hash());
+        if (!entry || !entry->depth()) {
+            break;
+        }
+        const Cell move = entry->best_move();
+        line->push_back({ entry->type(), entry->depth(), entry->value(), move });
+        if (!board->IsEmptyCell(move) || board->IsTerminalMove(move, stone, config_.is_exact_five())) {
+            break;
+        }
+        board->Set(move, stone);
+        played.push_back(move);
+        stone = stone == kEngine ? kPlayer : kEngine;
+    }
+    for (auto it = played.rbegin(); it != played.rend(); ++it) {
+        board->Set(*it, kEmpty);
+    }
+    #endif  // USE_CACHE
+}
+
+void Engine::ImportLine(Board* board, Stone stone, const std::vector<LineEntry>& line) {
+    #ifdef USE_CACHE
+    std::vector<Cell> played;
+    for (auto& imported : line) {
+        bool found;
+        Cache::Entry* entry = cache_.Find(board->hash(), &found);
+        if (!found || entry->depth() < imported.depth) {
+            entry->Store(board->hash(), imported.type, imported.depth, imported.value, imported.best_move);
+        }
+        const Cell move = imported.best_move;
+        if (!board->IsEmptyCell(move) || board->IsTerminalMove(move, stone, config_.is_exact_five())) {
+            break;
+        }
+        board->Set(move, stone);
+        played.push_back(move);
+        stone = stone == kEngine ? kPlayer : kEngine;
+    }
+    for (auto it = played.rbegin(); it != played.rend(); ++it) {
+        board->Set(*it, kEmpty);
+    }
+    #endif  // USE_CACHE
+}
+
+Score Engine::SearchRoot(Board* board, int depth, Score alpha, Score beta, int distance, Cell* best_move) {
+    const int width = board->width();
+    const int height = board->height();
+    if (width == 15 && height == 15) {
+        return NegaMax<Geometry15>(board, 0, depth, alpha, beta, 1, distance, best_move);
+    } else if (width == 19 && height == 19) {
+        return NegaMax<Geometry19>(board, 0, depth, alpha, beta, 1, distance, best_move);
+    } else if (width == 20 && height == 20) {
+        return NegaMax<Geometry20>(board, 0, depth, alpha, beta, 1, distance, best_move);
+    }
+    return NegaMax<RuntimeGeometry>(board, 0, depth, alpha, beta, 1, distance, best_move);
+}
+
+Score Engine::SearchRemote(Board* board, int depth, Cell* best_move) {
+    MoveList* moves = move_stack_.moves(0);
+    board->GetPossibleMoves(2, move_stack_.marker(), moves);
+    #ifdef USE_CACHE
+    const Cache::Entry* cached = cache_.Probe(board->hash());
+    if (cached) {
+        for (auto& move : *moves) {
+            if (move.cell == cached->best_move()) {
+                move.score = kCachedMoveScore;
+                moves->Sort();
+                break;
+            }
+        }
+    }
+    #endif  // USE_CACHE
+    // The workers get the lines known for the positions after the moves.
+    std::vector<Coordinator::Job> jobs;
+    for (auto& candidate : *moves) {
+        const Cell move = candidate.cell;
+        if (board->black() == kEngine && board->IsForbidden(move)) {
+            continue;
+        }
+        if (board->IsTerminalMove(move, kEngine, config_.is_exact_five())) {
+            *best_move = move;
+            return GetWinScore(0);
+        }
+        Coordinator::Job job;
+        job.move = move;
+        board->Set(move, kEngine);
+        ExportLine(board, kPlayer, depth - 1, &job.line);
+        board->Set(move, kEmpty);
+        jobs.push_back(std::move(job));
+    }
+
+    std::vector<Coordinator::Result> results;
+    const auto should_stop = [this]() {
+        return (stop_ && stop_->load(std::memory_order_relaxed)) ||
+               (is_time_limited_ && std::chrono::steady_clock::now() >= deadline_);
+    };
+    if (jobs.empty() ||
+        !coordinator_->Search(*board, depth - 1, jobs, should_stop, is_time_limited_ ? &deadline_ : nullptr, &results)) {
+        return SearchRoot(board, depth, -kInfinity, kInfinity, 2, best_move);
+    }
+    Score best_value = -kInfinity;
+    bool is_orphaned = false;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const Coordinator::Result& result = results[i];
+        if (!result.is_done) {
+            is_orphaned = true;
+            continue;
+        }
+        searched_nodes_ += result.nodes;
+        board->Set(jobs[i].move, kEngine);
+        ImportLine(board, kPlayer, result.line);
+        board->Set(jobs[i].move, kEmpty);
+        if (result.value > best_value) {
+            best_value = result.value;
+            *best_move = jobs[i].move;
+        }
+    }
+    if (is_orphaned) {
+        // Jobs are left over when the workers drop out, unless the search was
+        // stopped. The lines of the finished jobs are in the cache already.
+        if (!should_stop()) {
+            return SearchRoot(board, depth, -kInfinity, kInfinity, 2, best_move);
+        }
+        is_aborted_ = true;
+    }
+    #ifdef USE_CACHE
+    if (!is_aborted_) {
+        bool found;
+        Cache::Entry* entry = cache_.Find(board->hash(), &found);
+        entry->Store(board->hash(), Cache::Entry::kExact, depth, best_value, *best_move);
+    }
+    #endif  // USE_CACHE
+    return best_value;
+}
+
+template <typename Geometry>
+Score Engine::NegaMax(Board* node, int ply, int depth, Score alpha, Score beta, int color,
+                      int distance, Cell* best_move) {
+    // The callers limit the depth to kMaxSearchDepth. In a release build
+    // nothing else keeps the plies within the move stack.
+    if (depth == 0 || ply + 1 >= MoveStack::kMaxPlies) {
+        return Quiesce<Geometry>(node, ply, 0, alpha, beta, color);
+    }
+
     #ifdef COLLECT_STATISTICS
     node_count_ += 1ull;
     #endif  // COLLECT_STATISTICS
 
+    if (IsAborted()) {
+        return 0;
+    }
+
+    #ifdef USE_SEARCH_RECORDER
+    const int32_t record = recorder_.Enter(node->hash(), ply > 0 ? played_[ply - 1] : 0, ply, depth, alpha, beta);
+    uint8_t cache_outcome = SearchRecorder::kCacheMiss;
+    #endif  // USE_SEARCH_RECORDER
+
     #ifdef USE_CACHE
-    const float original_alpha = alpha;
+    const Score original_alpha = alpha;
     bool found;
     Cache::Entry* entry = cache_.Find(node->hash(), &found);
     if (found && entry->depth() >= depth) {
+        const Score cached_value = FromNodeScore(entry->value(), ply);
         uint8_t type = entry->type();
         if (type == Cache::Entry::kExact) {
             *best_move = entry->best_move();
-            return entry->value();
+            #ifdef USE_SEARCH_RECORDER
+            recorder_.Leave(record, cached_value, *best_move, SearchRecorder::kCacheCutoff, 0, -1);
+            #endif  // USE_SEARCH_RECORDER
+            return cached_value;
         } else if (type == Cache::Entry::kLowerBound) {
-            alpha = std::max(alpha, entry->value());
+            alpha = std::max(alpha, cached_value);
         } else if (type == Cache::Entry::kUpperBound) {
-            beta = std::min(beta, entry->value());
+            beta = std::min(beta, cached_value);
         }
         if (alpha >= beta) {
             *best_move = entry->best_move();
-            return entry->value();
+            #ifdef USE_SEARCH_RECORDER
+            recorder_.Leave(record, cached_value, *best_move, SearchRecorder::kCacheCutoff, 0, -1);
+            #endif  // USE_SEARCH_RECORDER
+            return cached_value;
         }
     }
+    #ifdef USE_SEARCH_RECORDER
+    if (found) {
+        cache_outcome = entry->depth() >= depth ? SearchRecorder::kCacheBound : SearchRecorder::kCacheShallow;
+    }
+    #endif  // USE_SEARCH_RECORDER
     #endif  // USE_CACHE
 
-    if (depth == 0) {
-        return color * Evaluate(node);
+    MoveList* moves = move_stack_.moves(ply);
+    {
+        #ifdef USE_TRACER
+        Tracer::Span generate_span(&tracer_, "generate moves", depth);
+        #endif  // USE_TRACER
+        node->GetPossibleMoves<Geometry>(distance, move_stack_.marker(), moves);
     }
-
-    CellSet moves;
-    Cell cached_best_move = entry->best_move();
-    if (found & node->IsEmptyCell(cached_best_move)) {
-        moves.insert(cached_best_move);
+    const Stone stone = color > 0 ? kEngine : kPlayer;
+    #ifdef FORCED_MOVES
+    const bool is_winning = SelectForcedMoves(node, ply, stone, moves);
+    #endif  // FORCED_MOVES
+    #ifdef USE_CACHE
+    // The cached best move is searched first, the rest keep the board order.
+    if (found) {
+        const Cell cached_best_move = entry->best_move();
+        for (auto& move : *moves) {
+            if (move.cell == cached_best_move) {
+                move.score = kCachedMoveScore;
+                moves->Sort();
+                break;
+            }
+        }
     }
-    node->GetPossibleMoves(distance, &moves);
+    #endif  // USE_CACHE
     // TODO(gyorgy): order moves.
-    float best_value = -kInfinity;
+    Score best_value = -kInfinity;
     Cell local_best_move = MakeCell(0, 0);
-    const Stone stone = color > 0.0f ? kEngine : kPlayer;
-    for (auto move : moves) {
-        // TODO(gyorgy): ignore the cached best move at second time.
-        float value;
-        if (node->IsTerminalMove(move, stone, config_.is_exact_five())) {
-            value = -color * kWinValue;
+    #ifndef FORCED_MOVES
+    const bool is_restricted = stone == node->black();
+    #endif  // FORCED_MOVES
+    #ifdef USE_TRACER
+    // Leaves are too short lived to trace one by one, the children of the last
+    // ply are traced as a single evaluation batch instead.
+    Tracer::Span evaluate_span(depth == 1 ? &tracer_ : nullptr, "evaluate batch");
+    #endif  // USE_TRACER
+    #ifdef USE_SEARCH_RECORDER
+    int cutoff = -1;
+    #endif  // USE_SEARCH_RECORDER
+    for (auto& candidate : *moves) {
+        const Cell move = candidate.cell;
+        #ifdef FORCED_MOVES
+        const bool is_terminal = is_winning;
+        #else  // FORCED_MOVES
+        if (is_restricted && node->IsForbidden(move)) {
+            continue;
+        }
+        const bool is_terminal = node->IsTerminalMove(move, stone, config_.is_exact_five());
+        #endif  // FORCED_MOVES
+        Score value;
+        if (is_terminal) {
+            value = GetWinScore(ply);
         } else {
+            played_[ply] = move;
             node->Set(move, stone);
-            value = -NegaMax(node, depth - 1, -beta, -alpha, -color, 1, &local_best_move);
+            value = -NegaMax<Geometry>(node, ply + 1, depth - 1, -beta, -alpha, -color, 1, &local_best_move);
             node->Set(move, kEmpty);
+            if (is_aborted_) {
+                return 0;
+            }
         }
 
         if (value > best_value) {
@@ -149,6 +516,9 @@ float Engine::NegaMax(Board* node, int depth, float alpha, float beta, float col
             #ifdef COLLECT_STATISTICS
             cutoff_count_ += 1ull;
             #endif  // COLLECT_STATISTICS
+            #ifdef USE_SEARCH_RECORDER
+            cutoff = static_cast<int>(&candidate - moves->begin());
+            #endif  // USE_SEARCH_RECORDER
             break;
         }
     }
@@ -162,71 +532,276 @@ float Engine::NegaMax(Board* node, int depth, float alpha, float beta, float col
     } else {
         type = Cache::Entry::kExact;
     }
-    entry->Store(type, depth, best_value, *best_move);
+    entry->Store(node->hash(), type, depth, ToNodeScore(best_value, ply), *best_move);
     #endif  // USE_CACHE
+    #ifdef USE_SEARCH_RECORDER
+    recorder_.Leave(record, best_value, *best_move, cache_outcome,
+                    cutoff < 0 ? moves->size() : cutoff + 1, cutoff);
+    #endif  // USE_SEARCH_RECORDER
 
     return best_value;
 }
 
-float Engine::Evaluate(const Board* board) {
-    static int kStrides[] = { Board::kUpRight, Board::kRight, Board::kDownRight, Board::kDown };
+#ifdef FORCED_MOVES
+bool Engine::SelectForcedMoves(Board* node, int ply, Stone stone, MoveList* moves) const {
+    const Stone opponent = stone == kEngine ? kPlayer : kEngine;
+    const bool is_restricted = stone == node->black();
+    int count = 0;
+    for (auto& candidate : *moves) {
+        const Cell move = candidate.cell;
+        if (is_restricted && node->IsForbidden(move)) {
+            continue;
+        }
+        if (node->IsTerminalMove(move, stone, config_.is_exact_five())) {
+            *moves->begin() = candidate;
+            moves->truncate(1);
+            return true;
+        }
+        *(moves->begin() + count++) = candidate;
+    }
+    moves->truncate(count);
+
+    // Below the root only the last move of the opponent can have made a threat,
+    // earlier ones have been answered. The root looks for the cells where the
+    // opponent would make a five or a straight four instead.
+    const bool is_exact_five = config_.is_exact_five();
+    Board::Threat threat = Board::kNoThreat;
+    if (ply > 0) {
+        threat = node->GetThreat(played_[ply - 1], opponent, is_exact_five);
+    } else {
+        for (auto& candidate : *moves) {
+            const Board::Threat other = node->GetThreat(candidate.cell, opponent, is_exact_five);
+            if (other == Board::kThreatFive) {
+                threat = Board::kThreatFour;
+                break;
+            }
+            if (other == Board::kThreatStraightFour) {
+                threat = Board::kThreatThree;
+            }
+        }
+    }
+    if (threat < Board::kThreatThree) {
+        return false;
+    }
+    // Any four of the opponent may be part of a defence against an open three.
+    const bool must_block = threat >= Board::kThreatFour;
+    const Board::Threat block_threshold = must_block ? Board::kThreatFive : Board::kThreatFour;
+    count = 0;
+    for (auto& candidate : *moves) {
+        const Cell move = candidate.cell;
+        const Board::Threat other = node->GetThreat(move, opponent, is_exact_five);
+        const Board::Threat own = must_block ? Board::kNoThreat : node->GetThreat(move, stone, is_exact_five);
+        if (other >= block_threshold || own >= Board::kThreatFour) {
+            *(moves->begin() + count++) = candidate;
+        }
+    }
+    // Without a block among the moves the game is lost anyway.
+    if (count) {
+        moves->truncate(count);
+    }
+    return false;
+}
+#endif  // FORCED_MOVES
+
+template <typename Geometry>
+Score Engine::Quiesce(Board* node, int ply, int depth, Score alpha, Score beta, int color) {
     #ifdef COLLECT_STATISTICS
-    eval_count_ += 1ull;
+    node_count_ += 1ull;
     #endif  // COLLECT_STATISTICS
-    CellSet cells;
-    board->GetCellsToEvaluate(3, &cells);
-    float value = 0.0f;
-    for (auto cell : cells) {
-        for (auto stride : kStrides) {
-            value += patterns_.GetValue(board->cell(cell), stride);
+    quiescence_nodes_ += 1u;
+
+    if (IsAborted()) {
+        return 0;
+    }
+
+    #ifdef USE_CACHE
+    const Score original_alpha = alpha;
+    bool found;
+    Cache::Entry* entry = cache_.Find(node->hash(), &found);
+    if (found) {
+        const Score cached_value = FromNodeScore(entry->value(), ply);
+        uint8_t type = entry->type();
+        if (type == Cache::Entry::kExact) {
+            return cached_value;
+        } else if (type == Cache::Entry::kLowerBound) {
+            alpha = std::max(alpha, cached_value);
+        } else if (type == Cache::Entry::kUpperBound) {
+            beta = std::min(beta, cached_value);
+        }
+        if (alpha >= beta) {
+            return cached_value;
         }
     }
-    return value;
+    #endif  // USE_CACHE
+
+    // Only the threat made by the last move of the opponent needs an answer,
+    // earlier threats have been answered or ignored on purpose already.
+    const Stone stone = color > 0 ? kEngine : kPlayer;
+    const Stone opponent = color > 0 ? kPlayer : kEngine;
+    const bool is_exact_five = config_.is_exact_five();
+    const Board::Threat threat = ply > 0 ? node->GetThreat(played_[ply - 1], opponent, is_exact_five) :
+                                 Board::kNoThreat;
+    const bool must_block = threat >= Board::kThreatFour;
+
+    const Score stand_pat = color * Evaluate<Geometry>(node, ply);
+    if (!must_block) {
+        if (stand_pat >= beta) {
+            return stand_pat;
+        }
+        alpha = std::max(alpha, stand_pat);
+    }
+    // A spent budget still lets the fours be blocked, or the lines that lose to
+    // them would look as good as the stand pat.
+    const bool is_over_budget = quiescence_limit_ > 0 && quiescence_nodes_ >= quiescence_limit_;
+    if (depth >= config_.quiescence_depth() || (is_over_budget && !must_block) || ply + 1 >= MoveStack::kMaxPlies) {
+        return stand_pat;
+    }
+
+    const bool is_restricted = stone == node->black();
+    MoveList* moves = move_stack_.moves(ply);
+    {
+        #ifdef USE_TRACER
+        Tracer::Span generate_span(&tracer_, "generate forcing moves", depth);
+        #endif  // USE_TRACER
+        node->GetPossibleMoves<Geometry>(2, move_stack_.marker(), moves);
+    }
+    // A four has to be blocked, an open three may be blocked or answered by a
+    // four. Otherwise the side to move makes fours, and open threes on the first
+    // few plies only.
+    const Board::Threat own_threshold = threat == Board::kNoThreat && depth < config_.quiescence_threes() ?
+                                        Board::kThreatThree : Board::kThreatFour;
+    const Board::Threat block_threshold = must_block ? Board::kThreatFive :
+                                          threat == Board::kThreatThree ? Board::kThreatStraightFour :
+                                          static_cast<Board::Threat>(Board::kThreatFive + 1);
+    int count = 0;
+    for (auto& candidate : *moves) {
+        const Cell move = candidate.cell;
+        if (is_restricted && node->IsForbidden(move)) {
+            continue;
+        }
+        if (node->IsTerminalMove(move, stone, config_.is_exact_five())) {
+            return GetWinScore(ply);
+        }
+        const Board::Threat other = node->GetThreat(move, opponent, is_exact_five);
+        const Board::Threat own = must_block ? Board::kNoThreat : node->GetThreat(move, stone, is_exact_five);
+        if (own < own_threshold && other < block_threshold) {
+            continue;
+        }
+        *(moves->begin() + count++) = Move{move, std::max(2 * own + 1, 2 * other)};
+    }
+    moves->truncate(count);
+    moves->Sort();
+
+    Score best_value = must_block ? -GetWinScore(ply + 1) : stand_pat;
+    Cell best_move = MakeCell(0, 0);
+    for (auto& candidate : *moves) {
+        const Cell move = candidate.cell;
+        played_[ply] = move;
+        node->Set(move, stone);
+        const Score value = -Quiesce<Geometry>(node, ply + 1, depth + 1, -beta, -alpha, -color);
+        node->Set(move, kEmpty);
+        if (is_aborted_) {
+            return 0;
+        }
+        if (value > best_value) {
+            best_value = value;
+            best_move = move;
+        }
+        if (best_value > alpha) {
+            alpha = best_value;
+        }
+        if (alpha >= beta) {
+            #ifdef COLLECT_STATISTICS
+            cutoff_count_ += 1ull;
+            #endif  // COLLECT_STATISTICS
+            break;
+        }
+    }
+
+    #ifdef USE_CACHE
+    uint8_t type;
+    if (best_value <= original_alpha) {
+        type = Cache::Entry::kUpperBound;
+    } else if (best_value >= beta) {
+        type = Cache::Entry::kLowerBound;
+    } else {
+        type = Cache::Entry::kExact;
+    }
+    entry->Store(node->hash(), type, 0, ToNodeScore(best_value, ply), best_move);
+    #endif  // USE_CACHE
+
+    return best_value;
+}
+
+void Engine::StartIteration() {
+    quiescence_limit_ = config_.quiescence_nodes() > 0 ?
+                        quiescence_nodes_ + static_cast<uint64_t>(config_.quiescence_nodes()) : 0;
 }
 
-constexpr float kValue0     = 0.0f;
-constexpr float kValue2     = 1e1f;
-constexpr float kValue2Open = 2e1f;
-constexpr float kValue3     = 1e2f;
-constexpr float kValue3Open = 2e2f;
-constexpr float kValue4     = 2e2f;
-constexpr float kValue4Open = 1e8f;
-constexpr float kValue5     = 1e10f;
-
-const Engine::Pattern Engine::kPatterns[] = {
-    { "OO+++", kValue2 }, { "XX+++", -kValue2 },
-    { "O+O++", kValue2 }, { "X+X++", -kValue2 },
-    { "O++O+", kValue2 }, { "X++X+", -kValue2 },
-    { "O+++O", kValue2 }, { "X+++X", -kValue2 },
-    { "++O+O", kValue2 }, { "++X+X", -kValue2 },
-    { "+++OO", kValue2 }, { "+++XX", -kValue2 },
-
-    { "+OO++", kValue2Open }, { "+XX++", -kValue2Open },
-    { "+O+O+", kValue2Open }, { "+X+X+", -kValue2Open },
-    { "+O++O+", kValue2Open }, { "+X++X+", -kValue2Open },
-    { "++OO+", kValue2Open }, { "++XX+", -kValue2Open },
-
-    { "OOO++", kValue3 }, { "XXX++", -kValue3 },
-    { "OO+O+", kValue3 }, { "XX+X+", -kValue3 },
-    { "OO++O", kValue3 }, { "XX++X", -kValue3 },
-    { "O+OO+", kValue3 }, { "X+XX+", -kValue3 },
-    { "O+O+O", kValue3 }, { "X+X+X", -kValue3 },
-    { "O++OO", kValue3 }, { "X++XX", -kValue3 },
-    { "+OO+O", kValue3 }, { "+XX+X", -kValue3 },
-    { "+O+OO", kValue3 }, { "+X+XX", -kValue3 },
-    { "++OOO", kValue3 }, { "++XXX", -kValue3 },
-
-    { "+OOO+", kValue3Open }, { "+XXX+", -kValue3Open },
-
-    { "OOOO+", kValue4 }, { "XXXX+", -kValue4 },
-    { "OOO+O", kValue4 }, { "XXX+X", -kValue4 },
-    { "OO+OO", kValue4 }, { "XX+XX", -kValue4 },
-    { "O+OOO", kValue4 }, { "X+XXX", -kValue4 },
-    { "+OOOO", kValue4 }, { "+XXXX", -kValue4 },
-
-    { "+OOOO+", kValue4Open }, { "+XXXX+", -kValue4Open },
-
-    { nullptr, kValue0 }
-};
+bool Engine::IsAborted() {
+    if (!is_aborted_) {
+        searched_nodes_ += 1u;
+        // The node limit is checked on every node, so the search ends at the
+        // same node whenever it is repeated.
+        if (max_nodes_ && searched_nodes_ > max_nodes_) {
+            is_aborted_ = true;
+        } else if (!(searched_nodes_ & kPollMask)) {
+            is_aborted_ = (stop_ && stop_->load(std::memory_order_relaxed)) ||
+                          (is_time_limited_ && std::chrono::steady_clock::now() >= deadline_);
+        }
+    }
+    return is_aborted_;
+}
+
+void Engine::GetPrincipalVariation(Board* board, Cell move, int depth, std::vector<Cell>* pv) {
+    Stone stone = kEngine;
+    while (static_cast<int>(pv->size()) < depth && board->IsEmptyCell(move)) {
+        pv->push_back(move);
+        if (board->IsTerminalMove(move, stone, config_.is_exact_five())) {
+            break;
+        }
+        board->Set(move, stone);
+        stone = stone == kEngine ? kPlayer : kEngine;
+        #ifdef USE_CACHE
+        const Cache::Entry* entry = cache_.Probe(board->hash());
+        if (!entry) {
+            break;
+        }
+        move = entry->best_move();
+        #else  // USE_CACHE
+        break;
+        #endif  // USE_CACHE
+    }
+    for (auto it = pv->rbegin(); it != pv->rend(); ++it) {
+        if (board->stone(*it) != kEmpty) {
+            board->Set(*it, kEmpty);
+        }
+    }
+}
+
+template <typename Geometry>
+Score Engine::Evaluate(const Board* board, int ply) {
+    #ifdef USE_EVAL_CACHE
+    Score cached_value;
+    if (eval_cache_.Find(board->hash(), &cached_value)) {
+        return cached_value;
+    }
+    #endif  // USE_EVAL_CACHE
+    #ifdef COLLECT_STATISTICS
+    eval_count_ += 1ull;
+    #endif  // COLLECT_STATISTICS
+    Score value;
+    if (network_) {
+        value = ClampEvaluation(std::llround(network_->Evaluate(*board->accumulator())));
+    } else {
+        // A leaf generates no moves, its slice of the move stack holds the cells.
+        MoveList* cells = move_stack_.moves(ply);
+        value = ClampEvaluation(evaluator_.Evaluate<Geometry>(*board, move_stack_.marker(), cells));
+    }
+    #ifdef USE_EVAL_CACHE
+    eval_cache_.Store(board->hash(), value);
+    #endif  // USE_EVAL_CACHE
+    return value;
+}
 
 }  // namespace asparagus
@@ -5,10 +5,29 @@
 
 #include "cache.h"
 #include "common.h"
-#include "patterns.h"
-
+#include "evaluator.h"
 #ifdef COLLECT_STATISTICS
+#include "latency_histogram.h"
+#endif  // COLLECT_STATISTICS
+#ifdef USE_EVAL_CACHE
+#include "eval_cache.h"
+#endif  // USE_EVAL_CACHE
+#include "move_stack.h"
+#include "score.h"
+#ifdef USE_SEARCH_RECORDER
+#include "search_recorder.h"
+#endif  // USE_SEARCH_RECORDER
+#ifdef USE_TRACER
+#include "tracer.h"
+#endif  // USE_TRACER
+
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#ifdef COLLECT_STATISTICS
 #include <ostream>
 #endif  // COLLECT_STATISTICS
 
@@ -16,34 +35,114 @@ namespace asparagus {
 
 class Config;
 class Board;
+class Coordinator;
+class Network;
+class NetworkAccumulator;
+class SolverTable;
+struct LineEntry;
+
+// Summary of the last completed iteration of a search.
+struct SearchInfo {
+    int depth = 0;
+    Score score = 0;
+    uint64_t nodes = 0;
+    double time = 0.0;
+    std::vector<Cell> pv;
+};
+
+// Optional controls of a single GetBestMove call.
+struct SearchControl {
+    // Aborts the search when set, the best move found so far is returned.
+    const std::atomic<bool>* stop = nullptr;
+    // Ignores the depth and time limits, only the stop flag ends the search.
+    bool is_infinite = false;
+    // Caps the time of the search in milliseconds over the limits of the
+    // config, zero for no cap.
+    int max_time = 0;
+    // Called after each completed iteration of the iterative deepening.
+    std::function<void(const SearchInfo& info)> on_iteration;
+};
 
 class Engine final {
 public:
     explicit Engine(const Config &config);
+    Engine(const Config &config, uint64_t cache_size);
+    ~Engine();
+
+    constexpr const SearchInfo& last_info() const { return last_info_; }
 
     void Start();
-    Cell GetBestMove(Board* board);
+    Cell GetBestMove(Board* board, const SearchControl* control = nullptr);
+    // Searches the position for the engine within the window, as a worker of a
+    // distributed search does. The cache is kept. Returns false if the time
+    // limit, zero for none, ran out before the value was found.
+    bool SearchWindow(Board* board, int depth, Score alpha, Score beta, int time_limit,
+                      Score* value, uint64_t* nodes);
+    // The cache entries along the best moves from the position, up to the given
+    // length, the stone is the side to move.
+    void ExportLine(Board* board, Stone stone, int max_length, std::vector<LineEntry>* line);
+    // Stores the entries of the line unless deeper ones are cached.
+    void ImportLine(Board* board, Stone stone, const std::vector<LineEntry>& line);
     #ifdef COLLECT_STATISTICS
     void PrintStats(std::ostream& out);
+    // {"game":<stats>,"session":<stats>,"process":<stats>} of the GetBestMove
+    // latencies, see LatencyStats::WriteJson.
+    void WriteLatencyJson(std::ostream& out);
     #endif  // COLLECT_STATISTICS
+    #ifdef USE_TRACER
+    Tracer* tracer() { return &tracer_; }
+    #endif  // USE_TRACER
+    #ifdef USE_SEARCH_RECORDER
+    SearchRecorder* recorder() { return &recorder_; }
+    #endif  // USE_SEARCH_RECORDER
 
 private:
-    struct Pattern {
-        const char* pattern_;
-        float value_;
-    };
-
-    static const Pattern kPatterns[];
+    static constexpr unsigned int kPollMask = 0xffu;
+    static constexpr int kMaxSearchDepth = 64;
+    static_assert(kMaxSearchDepth < MoveStack::kMaxPlies, "the quiescence search needs plies too");
 
     const Config &config_;
-    Patterns patterns_;
+    Evaluator evaluator_;
+    // Replaces the pattern evaluation when a network is configured, the board
+    // searched keeps the accumulator up to date.
+    const Network* network_;
+    std::unique_ptr<NetworkAccumulator> accumulator_;
+    // Solved positions of small boards, played without a search.
+    const SolverTable* solver_table_;
+    // Hands the root moves to worker processes when workers are configured.
+    std::unique_ptr<Coordinator> coordinator_;
     Cache cache_;
+    #ifdef USE_EVAL_CACHE
+    EvalCache eval_cache_;
+    #endif  // USE_EVAL_CACHE
+    MoveStack move_stack_;
+    Cell played_[MoveStack::kMaxPlies];
+    const std::atomic<bool>* stop_;
+    std::chrono::time_point<std::chrono::steady_clock> deadline_;
+    bool is_time_limited_;
+    // Zero if the nodes are unlimited.
+    uint64_t max_nodes_;
+    bool is_aborted_;
+    uint64_t searched_nodes_;
+    uint64_t quiescence_nodes_;
+    // Each iteration gets the configured quiescence nodes, zero is unlimited.
+    uint64_t quiescence_limit_;
+    SearchInfo last_info_;
+    #ifdef USE_TRACER
+    Tracer tracer_;
+    #endif  // USE_TRACER
+    #ifdef USE_SEARCH_RECORDER
+    SearchRecorder recorder_;
+    #endif  // USE_SEARCH_RECORDER
     #ifdef COLLECT_STATISTICS
     int node_count_;
     int eval_count_;
     int cutoff_count_;
     std::chrono::time_point<std::chrono::steady_clock> start_time_;
     double thinkig_time_;
+    // Since Start and since the engine was created.
+    LatencyStats game_latency_;
+    LatencyStats session_latency_;
     #ifdef AGGREGATED_STATISTICS
     uint64_t aggregated_node_count_;
     uint64_t aggregated_eval_count_;
@@ -51,9 +150,30 @@ private:
     #endif  // AGGREGATED_STATISCTICS
     #endif  // COLLECT_STATISTICS
 
-    float NegaMax(Board* node, int depth, float alpha, float beta, float color,
+    // Dispatches to the search instantiated for the geometry of the board.
+    Score SearchRoot(Board* board, int depth, Score alpha, Score beta, int distance, Cell* best_move);
+    // Searches the root moves on the workers, locally if none can be reached.
+    Score SearchRemote(Board* board, int depth, Cell* best_move);
+    template <typename Geometry>
+    Score NegaMax(Board* node, int ply, int depth, Score alpha, Score beta, int color,
                   int distance, Cell* best_move);
-    float Evaluate(const Board* board);
+    #ifdef FORCED_MOVES
+    // Drops the moves that lose at once when there is a threat on the board.
+    // A five leaves the only winning move, a four of the opponent its blocks,
+    // an open three the blocks and the fours of the side to move. Returns true
+    // if the only move left makes five.
+    bool SelectForcedMoves(Board* node, int ply, Stone stone, MoveList* moves) const;
+    #endif  // FORCED_MOVES
+    // Extends the horizon with forcing moves only: fives, blocks of fives, fours
+    // and open threes, and blocks of open threes. Past the node budget of the
+    // iteration only the blocks of fives are searched.
+    template <typename Geometry>
+    Score Quiesce(Board* node, int ply, int depth, Score alpha, Score beta, int color);
+    template <typename Geometry>
+    Score Evaluate(const Board* board, int ply);
+    void StartIteration();
+    bool IsAborted();
+    void GetPrincipalVariation(Board* board, Cell move, int depth, std::vector<Cell>* pv);
 
     DISALLOW_COPY_AND_ASSIGN(Engine);
 };
@@ -0,0 +1,41 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include <cstring>
+
+#include "eval_cache.h"
+
+namespace asparagus {
+
+EvalCache::EvalCache(uint64_t size) {
+    uint64_t entry_num = 1u;
+    while (entry_num * 2u * sizeof(Entry) <= size) {
+        entry_num *= 2u;
+    }
+    mask_ = entry_num - 1u;
+    entries_ = new Entry[entry_num];
+    Reset();
+}
+
+EvalCache::~EvalCache() {
+    delete [] entries_;
+}
+
+void EvalCache::Reset() {
+    memset(entries_, 0, (mask_ + 1u) * sizeof(Entry));
+
+    #ifdef COLLECT_STATISTICS
+    lookup_count_ = 0;
+    hit_count_ = 0;
+    #endif  // COLLECT_STATISTICS
+}
+
+#ifdef COLLECT_STATISTICS
+void EvalCache::PrintStats(std::ostream& out) {
+    out << "eval cache stats:" << std::endl;
+    out << "  entries       : " << mask_ + 1u << std::endl;
+    out << "  lookups       : " << lookup_count_ << std::endl;
+    out << "  hit rate      : " << 100.0 * double(hit_count_) / double(lookup_count_) << " %" << std::endl;
+}
+#endif  // COLLECT_STATISTICS
+
+}  // namespace asparagus
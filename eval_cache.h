@@ -0,0 +1,75 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_EVAL_CACHE_H
+#define ASPARAGUS_EVAL_CACHE_H
+
+#include "common.h"
+#include "score.h"
+
+#ifdef COLLECT_STATISTICS
+#include <ostream>
+#endif  // COLLECT_STATISTICS
+
+namespace asparagus {
+
+// Lossy table of static evaluations. The slot comes from the low bits of the
+// hash and the high bits are kept as a check, a colliding store simply
+// replaces the old value.
+class EvalCache final {
+public:
+    // The size is given in bytes and rounded down to a power of two entries.
+    explicit EvalCache(uint64_t size);
+    ~EvalCache();
+
+    void Reset();
+
+    bool Find(uint64_t hash, Score* value) {
+        #ifdef COLLECT_STATISTICS
+        lookup_count_ += 1ull;
+        #endif  // COLLECT_STATISTICS
+        const Entry& entry = entries_[hash & mask_];
+        if (entry.key_ != GetKey(hash)) {
+            return false;
+        }
+        #ifdef COLLECT_STATISTICS
+        hit_count_ += 1ull;
+        #endif  // COLLECT_STATISTICS
+        *value = entry.value_;
+        return true;
+    }
+
+    void Store(uint64_t hash, Score value) {
+        Entry& entry = entries_[hash & mask_];
+        entry.key_ = GetKey(hash);
+        entry.value_ = value;
+    }
+
+    #ifdef COLLECT_STATISTICS
+    void PrintStats(std::ostream& out);
+    #endif  // COLLECT_STATISTICS
+
+private:
+    struct Entry {
+        uint32_t key_;
+        Score value_;
+    };
+
+    // Zero marks an empty entry.
+    static constexpr uint32_t GetKey(uint64_t hash) {
+        return static_cast<uint32_t>(hash >> 32u) | 1u;
+    }
+
+    uint64_t mask_;
+    Entry* entries_;
+
+    #ifdef COLLECT_STATISTICS
+    uint64_t lookup_count_;
+    uint64_t hit_count_;
+    #endif  // COLLECT_STATISTICS
+
+    DISALLOW_COPY_AND_ASSIGN(EvalCache);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_EVAL_CACHE_H
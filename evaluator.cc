@@ -0,0 +1,126 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "evaluator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include "board.h"
+#include "patterns.h"
+#include "position_stream.h"
+
+namespace asparagus {
+
+static const int kStrides[] = { Board::kUpRight, Board::kRight, Board::kDownRight, Board::kDown };
+
+// Finds the start of every record, stops at the first truncated one.
+static std::vector<const uint8_t*> IndexRecords(const uint8_t* records, size_t size) {
+    std::vector<const uint8_t*> index;
+    const uint8_t* end = records + size;
+    while (end - records >= PositionStream::kRecordHeaderSize) {
+        const size_t record_size = PositionStream::GetRecordSize(records[0], records[1]);
+        if (static_cast<size_t>(end - records) < record_size) {
+            break;
+        }
+        index.push_back(records);
+        records += record_size;
+    }
+    return index;
+}
+
+// Runs the work on equal slices of the records, one thread per slice.
+static void RunSliced(size_t count, int threads, const std::function<void(size_t, size_t)>& work) {
+    const size_t thread_count = std::max<size_t>(1u, std::min<size_t>(threads, count));
+    const size_t slice = (count + thread_count - 1u) / thread_count;
+    std::vector<std::thread> workers;
+    for (size_t first = slice; first < count; first += slice) {
+        workers.emplace_back(work, first, std::min(count, first + slice));
+    }
+    work(0, std::min(count, slice));
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+Evaluator::Evaluator(const Patterns& patterns)
+    :   patterns_(patterns),
+        storage_(new Move[MoveList::kCapacity]) {
+    cells_.Attach(storage_.get());
+}
+
+Score Evaluator::Evaluate(const Board& board) {
+    cells_.clear();
+    return Evaluate<RuntimeGeometry>(board, &marker_, &cells_);
+}
+
+template <typename Geometry>
+Score Evaluator::Evaluate(const Board& board, CellMarker* marker, MoveList* cells) const {
+    board.GetCellsToEvaluate<Geometry>(3, marker, cells);
+    Score value = 0;
+    for (auto& cell : *cells) {
+        for (auto stride : kStrides) {
+            value += patterns_.GetValue(board.cell(cell.cell), stride);
+        }
+    }
+    return value;
+}
+
+void Evaluator::GetFeatures(const Board& board, int16_t* features) {
+    memset(features, 0, patterns_.size() * sizeof(int16_t));
+    cells_.clear();
+    board.GetCellsToEvaluate(3, &marker_, &cells_);
+    for (auto& cell : cells_) {
+        for (auto stride : kStrides) {
+            const int index = patterns_.GetIndex(board.cell(cell.cell), stride);
+            if (index != Patterns::kNoPattern) {
+                features[index] += 1;
+            }
+        }
+    }
+}
+
+size_t Evaluator::EvaluateBatch(const Patterns& patterns, const uint8_t* records, size_t size,
+                                int threads, std::vector<Score>* scores) {
+    const std::vector<const uint8_t*> index = IndexRecords(records, size);
+    scores->assign(index.size(), 0);
+    const uint8_t* end = records + size;
+    RunSliced(index.size(), threads, [&](size_t first, size_t last) {
+        Evaluator evaluator(patterns);
+        Board board;
+        Stone to_move;
+        for (size_t i = first; i < last; i++) {
+            if (PositionStream::Decode(index[i], end - index[i], &board, &to_move)) {
+                (*scores)[i] = evaluator.Evaluate(board);
+            }
+        }
+    });
+    return index.size();
+}
+
+size_t Evaluator::GetFeaturesBatch(const Patterns& patterns, const uint8_t* records, size_t size,
+                                   int threads, std::vector<int16_t>* features) {
+    const std::vector<const uint8_t*> index = IndexRecords(records, size);
+    const size_t width = patterns.size();
+    features->assign(index.size() * width, 0);
+    const uint8_t* end = records + size;
+    RunSliced(index.size(), threads, [&](size_t first, size_t last) {
+        Evaluator evaluator(patterns);
+        Board board;
+        Stone to_move;
+        for (size_t i = first; i < last; i++) {
+            if (PositionStream::Decode(index[i], end - index[i], &board, &to_move)) {
+                evaluator.GetFeatures(board, features->data() + i * width);
+            }
+        }
+    });
+    return index.size();
+}
+
+template Score Evaluator::Evaluate<Geometry15>(const Board& board, CellMarker* marker, MoveList* cells) const;
+template Score Evaluator::Evaluate<Geometry19>(const Board& board, CellMarker* marker, MoveList* cells) const;
+template Score Evaluator::Evaluate<Geometry20>(const Board& board, CellMarker* marker, MoveList* cells) const;
+template Score Evaluator::Evaluate<RuntimeGeometry>(const Board& board, CellMarker* marker, MoveList* cells) const;
+
+}  // namespace asparagus
@@ -0,0 +1,53 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_EVALUATOR_H
+#define ASPARAGUS_EVALUATOR_H
+
+#include <memory>
+#include <vector>
+
+#include "common.h"
+#include "move_stack.h"
+#include "score.h"
+
+namespace asparagus {
+
+class Board;
+class Patterns;
+
+// Static evaluation of positions, usable without an Engine. Scores are seen
+// from the side of the O stones: every cell around the stones contributes the
+// value of the pattern starting there in four directions.
+class Evaluator final {
+public:
+    explicit Evaluator(const Patterns& patterns);
+
+    constexpr const Patterns& patterns() const { return patterns_; }
+
+    Score Evaluate(const Board& board);
+    // The search passes its own scratch space.
+    template <typename Geometry>
+    Score Evaluate(const Board& board, CellMarker* marker, MoveList* cells) const;
+    // Counts the matches of every pattern, features has patterns().size() slots.
+    void GetFeatures(const Board& board, int16_t* features);
+
+    // Batch versions over a buffer of PositionStream records without the stream
+    // header. The records are split evenly across the threads, both return the
+    // number of records.
+    static size_t EvaluateBatch(const Patterns& patterns, const uint8_t* records, size_t size,
+                                int threads, std::vector<Score>* scores);
+    static size_t GetFeaturesBatch(const Patterns& patterns, const uint8_t* records, size_t size,
+                                   int threads, std::vector<int16_t>* features);
+
+private:
+    const Patterns& patterns_;
+    CellMarker marker_;
+    std::unique_ptr<Move[]> storage_;
+    MoveList cells_;
+
+    DISALLOW_COPY_AND_ASSIGN(Evaluator);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_EVALUATOR_H
@@ -0,0 +1,368 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "game_log.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace asparagus {
+
+static const char kMagic[4] = { 'A', 'G', 'L', 'G' };
+static constexpr uint8_t kVersion = 1;
+
+static void PutUint32(uint32_t value, uint8_t* data) {
+    for (int i = 0; i < 4; i++) {
+        data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint32_t GetUint32(const uint8_t* data) {
+    return data[0] | data[1] << 8u | data[2] << 16u | static_cast<uint32_t>(data[3]) << 24u;
+}
+
+// FNV-1a.
+static uint32_t GetChecksum(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void PutVarint(uint64_t value, std::vector<uint8_t>* data) {
+    while (value >= 0x80u) {
+        data->push_back(static_cast<uint8_t>(value | 0x80u));
+        value >>= 7u;
+    }
+    data->push_back(static_cast<uint8_t>(value));
+}
+
+static bool GetVarint(const uint8_t** data, const uint8_t* end, uint64_t* value) {
+    *value = 0;
+    for (unsigned int shift = 0; shift < 64 && *data < end; shift += 7) {
+        const uint8_t byte = *(*data)++;
+        *value |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+        if (!(byte & 0x80u)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1u) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1u) ^ -static_cast<int64_t>(value & 1u);
+}
+
+static bool WriteAll(int fd, const uint8_t* data, size_t size) {
+    while (size) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+GameLog::GameLog()
+    :   is_running_(false),
+        is_flushing_(false),
+        is_failed_(false),
+        fd_(-1) {}
+
+GameLog::~GameLog() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_running_ = false;
+        }
+        ready_.notify_one();
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool GameLog::Open(const std::string& path) {
+    if (fd_ >= 0) {
+        return false;
+    }
+    // The valid part of an existing log, appending starts after it.
+    size_t end = 0;
+    MappedFile file;
+    if (file.Open(path)) {
+        if (!IsHeader(file.data(), file.size())) {
+            return false;
+        }
+        end = kHeaderSize;
+        uint32_t games;
+        while (const size_t payload = CheckBlock(file.data() + end, file.size() - end, &games)) {
+            end += kBlockHeaderSize + payload;
+        }
+        file.Close();
+    }
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (!end) {
+        uint8_t header[kHeaderSize] = {};
+        memcpy(header, kMagic, sizeof(kMagic));
+        header[4] = kVersion;
+        end = kHeaderSize;
+        if (ftruncate(fd, 0) || !WriteAll(fd, header, kHeaderSize)) {
+            close(fd);
+            return false;
+        }
+    } else if (ftruncate(fd, end) || lseek(fd, end, SEEK_SET) < 0) {
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+    is_running_ = true;
+    thread_ = std::thread(&GameLog::Work, this);
+    return true;
+}
+
+void GameLog::Write(const GameRecord& game) {
+    if (fd_ < 0 || game.moves.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (is_failed_) {
+            return;
+        }
+        games_.push_back(game);
+    }
+    ready_.notify_one();
+}
+
+bool GameLog::Flush() {
+    if (fd_ < 0) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_flushing_ = true;
+    ready_.notify_one();
+    flushed_.wait(lock, [this] { return !is_flushing_; });
+    return !is_failed_;
+}
+
+void GameLog::Work() {
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> data;
+    uint32_t games = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        ready_.wait(lock, [this] { return !games_.empty() || is_flushing_ || !is_running_; });
+        while (!games_.empty()) {
+            const GameRecord game = std::move(games_.front());
+            games_.pop_front();
+            lock.unlock();
+            Encode(game, &data);
+            payload.insert(payload.end(), data.begin(), data.end());
+            games += 1;
+            bool is_written = true;
+            if (payload.size() >= kBlockSize) {
+                is_written = WriteBlock(payload, games);
+                payload.clear();
+                games = 0;
+            }
+            lock.lock();
+            if (!is_written) {
+                Fail();
+            }
+        }
+        if (is_flushing_ || !is_running_) {
+            if (games) {
+                lock.unlock();
+                const bool is_written = WriteBlock(payload, games);
+                payload.clear();
+                games = 0;
+                lock.lock();
+                if (!is_written) {
+                    Fail();
+                }
+            }
+            is_flushing_ = false;
+            flushed_.notify_all();
+            if (!is_running_) {
+                return;
+            }
+        }
+    }
+}
+
+void GameLog::Fail() {
+    // A block cut short ends the log for the readers, nothing after it is read.
+    if (!is_failed_) {
+        std::cerr << "error: cannot write game log, logging stopped" << std::endl;
+    }
+    is_failed_ = true;
+    games_.clear();
+}
+
+bool GameLog::WriteBlock(const std::vector<uint8_t>& payload, uint32_t games) {
+    // Only the thread of the log sets is_failed_.
+    if (is_failed_) {
+        return false;
+    }
+    uint8_t header[kBlockHeaderSize];
+    PutUint32(static_cast<uint32_t>(payload.size()), header);
+    PutUint32(games, header + 4);
+    PutUint32(GetChecksum(payload.data(), payload.size()), header + 8);
+    return WriteAll(fd_, header, kBlockHeaderSize) && WriteAll(fd_, payload.data(), payload.size());
+}
+
+void GameLog::Encode(const GameRecord& game, std::vector<uint8_t>* data) {
+    data->clear();
+    PutVarint(game.width, data);
+    PutVarint(game.height, data);
+    PutVarint((game.is_exact_five ? 1u : 0u) | (game.is_renju ? 2u : 0u), data);
+    PutVarint(game.result, data);
+    PutVarint(game.moves.size(), data);
+    // Games start around the center, the first deltas are small too.
+    int x = (game.width + 1) / 2;
+    int y = (game.height + 1) / 2;
+    for (const GameMove& move : game.moves) {
+        const int next_x = GetX(move.cell);
+        const int next_y = GetY(move.cell);
+        PutVarint(ZigZag(next_x - x) << 3u | (move.stone & 3u) << 1u | (move.is_searched ? 1u : 0u), data);
+        PutVarint(ZigZag(next_y - y), data);
+        if (move.is_searched) {
+            PutVarint(move.depth, data);
+            PutVarint(ZigZag(move.score), data);
+            PutVarint(move.nodes, data);
+            PutVarint(move.time_us, data);
+        }
+        x = next_x;
+        y = next_y;
+    }
+}
+
+size_t GameLog::Decode(const uint8_t* data, size_t size, GameRecord* game) {
+    const uint8_t* next = data;
+    const uint8_t* end = data + size;
+    uint64_t width, height, flags, result, count;
+    if (!GetVarint(&next, end, &width) || !GetVarint(&next, end, &height) ||
+        !GetVarint(&next, end, &flags) || !GetVarint(&next, end, &result) ||
+        !GetVarint(&next, end, &count)) {
+        return 0;
+    }
+    // Every move takes at least two bytes.
+    if (width < Board::kMinSize || width > Board::kMaxSize ||
+        height < Board::kMinSize || height > Board::kMaxSize ||
+        result > GameRecord::kDraw || count > static_cast<uint64_t>(end - next) / 2) {
+        return 0;
+    }
+    game->width = static_cast<int>(width);
+    game->height = static_cast<int>(height);
+    game->is_exact_five = flags & 1u;
+    game->is_renju = flags & 2u;
+    game->result = static_cast<GameRecord::Result>(result);
+    game->moves.resize(count);
+    int64_t x = (game->width + 1) / 2;
+    int64_t y = (game->height + 1) / 2;
+    for (GameMove& move : game->moves) {
+        uint64_t head, delta_y;
+        if (!GetVarint(&next, end, &head) || !GetVarint(&next, end, &delta_y)) {
+            return 0;
+        }
+        x += UnZigZag(head >> 3u);
+        y += UnZigZag(delta_y);
+        move.stone = static_cast<Stone>((head >> 1u) & 3u);
+        if (x < 1 || x > game->width || y < 1 || y > game->height || move.stone == kForbidden) {
+            return 0;
+        }
+        move.cell = MakeCell(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
+        move.is_searched = head & 1u;
+        uint64_t depth = 0, score = 0, nodes = 0, time_us = 0;
+        if (move.is_searched &&
+            (!GetVarint(&next, end, &depth) || !GetVarint(&next, end, &score) ||
+             !GetVarint(&next, end, &nodes) || !GetVarint(&next, end, &time_us))) {
+            return 0;
+        }
+        move.depth = static_cast<uint8_t>(depth);
+        move.score = static_cast<int32_t>(UnZigZag(score));
+        move.nodes = nodes;
+        move.time_us = static_cast<uint32_t>(time_us);
+    }
+    return next - data;
+}
+
+bool GameLog::IsHeader(const uint8_t* data, size_t size) {
+    return size >= kHeaderSize && !memcmp(data, kMagic, sizeof(kMagic)) && data[4] == kVersion;
+}
+
+size_t GameLog::CheckBlock(const uint8_t* data, size_t size, uint32_t* games) {
+    if (size < kBlockHeaderSize) {
+        return 0;
+    }
+    const size_t payload = GetUint32(data);
+    *games = GetUint32(data + 4);
+    if (!payload || size - kBlockHeaderSize < payload ||
+        GetChecksum(data + kBlockHeaderSize, payload) != GetUint32(data + 8)) {
+        return 0;
+    }
+    return payload;
+}
+
+GameLogReader::GameLogReader()
+    :   offset_(0),
+        block_end_(0),
+        block_games_(0) {}
+
+bool GameLogReader::Open(const std::string& path) {
+    if (!file_.Open(path) || !GameLog::IsHeader(file_.data(), file_.size())) {
+        file_.Close();
+        return false;
+    }
+    offset_ = GameLog::kHeaderSize;
+    block_end_ = offset_;
+    block_games_ = 0;
+    return true;
+}
+
+bool GameLogReader::Next(GameRecord* game) {
+    if (!file_.data()) {
+        return false;
+    }
+    while (!block_games_) {
+        if (offset_ != block_end_) {
+            return false;
+        }
+        const size_t payload = GameLog::CheckBlock(file_.data() + offset_, file_.size() - offset_,
+                                                   &block_games_);
+        if (!payload) {
+            block_games_ = 0;
+            return false;
+        }
+        offset_ += GameLog::kBlockHeaderSize;
+        block_end_ = offset_ + payload;
+    }
+    const size_t size = GameLog::Decode(file_.data() + offset_, block_end_ - offset_, game);
+    if (!size) {
+        block_games_ = 0;
+        block_end_ = 0;
+        return false;
+    }
+    offset_ += size;
+    block_games_ -= 1;
+    return true;
+}
+
+}  // namespace asparagus
@@ -0,0 +1,138 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_GAME_LOG_H
+#define ASPARAGUS_GAME_LOG_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+#include "common.h"
+#include "mapped_file.h"
+
+namespace asparagus {
+
+// A move of a logged game, stones set by hand or taken back are moves too.
+// Search metadata is only present on moves found by the engine.
+struct GameMove {
+    Cell cell;
+    Stone stone;
+    bool is_searched;
+    uint8_t depth;
+    // Saturates at the int32_t range, so wins keep their sign.
+    int32_t score;
+    uint64_t nodes;
+    uint32_t time_us;
+};
+
+struct GameRecord {
+    enum Result { kUnfinished, kEngineWon, kPlayerWon, kDraw };
+
+    int width = 0;
+    int height = 0;
+    bool is_exact_five = false;
+    bool is_renju = false;
+    Result result = kUnfinished;
+    std::vector<GameMove> moves;
+
+    // Calls visit(board, move) with the board before every move. Under Renju
+    // the side of the first stone plays black.
+    template <typename Visit>
+    void Replay(Board* board, Visit visit) const {
+        if (board->width() == width && board->height() == height) {
+            board->Clear();
+        } else {
+            board->Initialize(width, height);
+        }
+        Stone black = kEmpty;
+        for (const GameMove& move : moves) {
+            if (is_renju && IsStone(move.stone)) {
+                black = move.stone;
+                break;
+            }
+        }
+        board->SetRenju(black);
+        for (const GameMove& move : moves) {
+            visit(*board, move);
+            board->Set(move.cell, move.stone);
+        }
+    }
+};
+
+// The log is a header followed by blocks of whole games. A block is its
+// payload size, game count and checksum, each a little endian uint32_t, then
+// the games: varints of the sizes, flags, result and move count, and per move
+// the zigzag deltas of the coordinates to the previous move, the stone and the
+// search metadata. Typical moves take a few bytes this way.
+class GameLog final {
+public:
+    static constexpr int kHeaderSize = 8;
+    static constexpr int kBlockHeaderSize = 12;
+    // Games are buffered up to this many bytes before a block is written.
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    GameLog();
+    // Writes the pending games.
+    ~GameLog();
+
+    // Opens the log for appending, a missing file is created. A block cut short
+    // by a crash is dropped.
+    bool Open(const std::string& path);
+    // Queues the game, encoding and writing happen on the thread of the log.
+    // The log stops at the first failed write, later games are dropped.
+    void Write(const GameRecord& game);
+    // Writes the queued games and the partial block, returns false once a write
+    // has failed.
+    bool Flush();
+
+    static void Encode(const GameRecord& game, std::vector<uint8_t>* data);
+    // Returns the bytes read, zero if the data does not hold a valid game.
+    static size_t Decode(const uint8_t* data, size_t size, GameRecord* game);
+    static bool IsHeader(const uint8_t* data, size_t size);
+    // Returns the payload size of a valid block, zero otherwise.
+    static size_t CheckBlock(const uint8_t* data, size_t size, uint32_t* games);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable flushed_;
+    std::deque<GameRecord> games_;
+    bool is_running_;
+    bool is_flushing_;
+    bool is_failed_;
+    int fd_;
+    std::thread thread_;
+
+    void Work();
+    // Stops the log, called with the mutex held.
+    void Fail();
+    bool WriteBlock(const std::vector<uint8_t>& payload, uint32_t games);
+
+    DISALLOW_COPY_AND_ASSIGN(GameLog);
+};
+
+// Reads the games of a log in order from a memory-mapped file.
+class GameLogReader final {
+public:
+    GameLogReader();
+
+    bool Open(const std::string& path);
+    // False at the end of the log or at the first damaged block.
+    bool Next(GameRecord* game);
+
+private:
+    MappedFile file_;
+    size_t offset_;
+    size_t block_end_;
+    uint32_t block_games_;
+
+    DISALLOW_COPY_AND_ASSIGN(GameLogReader);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_GAME_LOG_H
@@ -2,12 +2,276 @@
 
 #include "gomocup_protocol.h"
 
+#include <algorithm>
+#include <chrono>
+
+#include "board.h"
+#include "config.h"
+#include "controller.h"
+
 namespace asparagus {
 
+static std::string ReadLine(std::istream& in, bool* is_ok) {
+    std::string line;
+    *is_ok = static_cast<bool>(std::getline(in, line));
+    while (!line.empty() && isspace(line.back())) {
+        line.pop_back();
+    }
+    return line;
+}
+
+// Parses count comma separated numbers, the whole text has to be used up.
+static bool ParseNumbers(const std::string& text, int count, int* values) {
+    size_t begin = 0;
+    for (int i = 0; i < count; i++) {
+        const size_t comma = i + 1 < count ? text.find(',', begin) : text.size();
+        if (comma == std::string::npos || !Config::ParseNumber(text.substr(begin, comma - begin), &values[i])) {
+            return false;
+        }
+        begin = comma + 1;
+    }
+    return true;
+}
+
+GomocupProtocol::GomocupProtocol(Config* config, Controller* controller, std::ostream& output)
+    :   Protocol(output),
+        config_(config),
+        controller_(controller),
+        search_thread_(controller),
+        width_(0),
+        height_(0),
+        timeout_turn_(30000),
+        timeout_match_(0),
+        time_left_(-1),
+        time_used_(0),
+        pending_rule_(-1) {}
+
+GomocupProtocol::~GomocupProtocol() {
+    search_thread_.Stop();
+    search_thread_.Wait();
+}
+
 bool GomocupProtocol::HandleRequest(std::istream& request, std::ostream& response) {
-    // TODO(gyorgy): Implement it.
-    return false;
+    bool is_ok;
+    const std::string line = ReadLine(request, &is_ok);
+    if (!is_ok) {
+        HandleEnd();
+        return false;
+    }
+    const size_t separator = line.find(' ');
+    std::string command = line.substr(0, separator);
+    const std::string args = separator == std::string::npos ? "" : line.substr(separator + 1);
+    std::transform(command.begin(), command.end(), command.begin(), ::toupper);
+    if (command.empty()) {
+        return false;
+    }
+
+    // Only requests that leave the board alone are served while searching.
+    if (command == "INFO") {
+        HandleInfo(args, response);
+        return response.tellp() > 0;
+    } else if (command == "END") {
+        HandleEnd();
+        return false;
+    } else if (command == "ABOUT") {
+        HandleAbout(response);
+        return true;
+    }
+    search_thread_.Wait();
+    ApplyRule();
+
+    int size[2];
+    if (command == "START") {
+        if (ParseNumbers(args, 1, size)) {
+            HandleStart(size[0], size[0], response);
+        } else {
+            response << "ERROR invalid size: " << args;
+        }
+    } else if (command == "RECTSTART") {
+        if (ParseNumbers(args, 2, size)) {
+            HandleStart(size[0], size[1], response);
+        } else {
+            response << "ERROR invalid size: " << args;
+        }
+    } else if (command == "RESTART") {
+        HandleStart(width_, height_, response);
+    } else if (command == "TURN") {
+        HandleTurn(args, response);
+    } else if (command == "BEGIN") {
+        HandleBegin(response);
+    } else if (command == "BOARD") {
+        HandleBoard(request, response);
+    } else if (command == "TAKEBACK") {
+        HandleTakeback(args, response);
+    } else {
+        response << "UNKNOWN command: " << line;
+    }
+    return response.tellp() > 0;
 }
 
-}  // namespace asparagus
+void GomocupProtocol::HandleStart(int width, int height, std::ostream& response) {
+    if (width < Board::kMinSize || width > Board::kMaxSize ||
+        height < Board::kMinSize || height > Board::kMaxSize) {
+        response << "ERROR unsupported size: " << width << "x" << height;
+        return;
+    }
+    width_ = width;
+    height_ = height;
+    time_used_ = 0;
+    controller_->Start(width, height);
+    response << "OK";
+}
+
+void GomocupProtocol::HandleTurn(const std::string& args, std::ostream& response) {
+    Cell move;
+    if (!ParseCell(args, &move) || !controller_->board().IsEmptyCell(move)) {
+        response << "ERROR invalid move: " << args;
+        return;
+    }
+    controller_->PlayerMove(move);
+    StartSearch();
+}
+
+void GomocupProtocol::HandleBegin(std::ostream& response) {
+    if (controller_->state() == Controller::kUnknown) {
+        response << "ERROR game is not started";
+        return;
+    }
+    StartSearch();
+}
+
+void GomocupProtocol::HandleBoard(std::istream& request, std::ostream& response) {
+    if (controller_->state() == Controller::kUnknown) {
+        response << "ERROR game is not started";
+        return;
+    }
+    // The board of the next turn mostly repeats the last one, the cache is kept.
+    controller_->ClearBoard();
+    std::string bad_line;
+    bool is_ok = true;
+    while (is_ok) {
+        const std::string line = ReadLine(request, &is_ok);
+        if (line == "DONE" || line == "done") {
+            if (bad_line.empty()) {
+                StartSearch();
+            } else {
+                response << "ERROR invalid board line: " << bad_line;
+            }
+            return;
+        }
+        // The rest of the board is read anyway, so that it is not taken for commands.
+        int values[3];
+        if (line.empty()) {
+            continue;
+        } else if (!ParseNumbers(line, 3, values)) {
+            if (bad_line.empty()) {
+                bad_line = line;
+            }
+            continue;
+        }
+        const int x = values[0];
+        const int y = values[1];
+        const int field = values[2];
+        if (x < 0 || y < 0 || x >= width_ || y >= height_) {
+            continue;
+        }
+        const Cell cell = MakeCell(x + 1, y + 1);
+        if (field == 1) {
+            controller_->SetCell(cell, kEngine);
+        } else if (field == 2) {
+            controller_->SetCell(cell, kPlayer);
+        }
+    }
+}
+
+void GomocupProtocol::HandleInfo(const std::string& args, std::ostream& response) {
+    const size_t separator = args.find(' ');
+    const std::string key = args.substr(0, separator);
+    if (key != "timeout_turn" && key != "timeout_match" && key != "time_left" && key != "rule") {
+        return;
+    }
+    int value;
+    if (separator == std::string::npos || !Config::ParseNumber(args.substr(separator + 1), &value)) {
+        response << "ERROR invalid info: " << args;
+        return;
+    }
+    if (key == "timeout_turn") {
+        timeout_turn_ = value;
+    } else if (key == "timeout_match") {
+        timeout_match_ = value;
+    } else if (key == "time_left") {
+        time_left_ = value;
+    } else if (key == "rule") {
+        // A search may be running on the configuration, see ApplyRule.
+        pending_rule_ = value;
+    }
+}
+
+void GomocupProtocol::ApplyRule() {
+    if (pending_rule_ >= 0) {
+        config_->Set("is_exact_five", pending_rule_ & 1);
+        config_->Set("renju", (pending_rule_ & 4) != 0);
+        pending_rule_ = -1;
+    }
+}
+
+void GomocupProtocol::HandleTakeback(const std::string& args, std::ostream& response) {
+    Cell cell;
+    if (!ParseCell(args, &cell)) {
+        response << "ERROR invalid move: " << args;
+        return;
+    }
+    controller_->SetCell(cell, kEmpty);
+    response << "OK";
+}
+
+void GomocupProtocol::HandleEnd() {
+    search_thread_.Stop();
+    search_thread_.Wait();
+    Quit();
+}
 
+void GomocupProtocol::HandleAbout(std::ostream& response) {
+    response << "name=\"asparagus\", version=\"0.1\", author=\"Gyorgy Abonyi\"";
+}
+
+bool GomocupProtocol::ParseCell(const std::string& args, Cell* cell) const {
+    int values[2];
+    if (!ParseNumbers(args, 2, values)) {
+        return false;
+    }
+    const int x = values[0];
+    const int y = values[1];
+    // Cells wrap around beyond the stride, so the range is checked first.
+    if (x < 0 || y < 0 || x >= controller_->board().width() || y >= controller_->board().height()) {
+        return false;
+    }
+    *cell = MakeCell(x + 1, y + 1);
+    return true;
+}
+
+int GomocupProtocol::GetTimeLimit() const {
+    // A zero turn timeout asks for the fastest possible answer.
+    int limit = timeout_turn_;
+    if (timeout_match_ > 0) {
+        const int left = time_left_ >= 0 ? time_left_ : timeout_match_ - time_used_;
+        limit = std::min(limit, left / kMovesToGo);
+    }
+    return std::max(1, limit - kSafetyMargin);
+}
+
+void GomocupProtocol::StartSearch() {
+    config_->Set("time_limit", GetTimeLimit());
+    const auto start_time = std::chrono::steady_clock::now();
+    search_thread_.Start(SearchControl(), [this, start_time](Cell move) {
+        const auto end_time = std::chrono::steady_clock::now();
+        time_used_ += std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        if (GetX(move)) {
+            Send(std::to_string(GetX(move) - 1) + "," + std::to_string(GetY(move) - 1));
+        } else {
+            Send("ERROR no move is possible");
+        }
+    });
+}
+
+}  // namespace asparagus
@@ -5,17 +5,57 @@
 
 #include "protocol.h"
 
+#include <string>
+
 #include "common.h"
+#include "search_thread.h"
 
 namespace asparagus {
 
+class Config;
+class Controller;
+
+// Implements the Piskvork (Gomocup) brain protocol. Coordinates are zero based on
+// the wire. Engine moves are searched on a worker thread, so INFO and END are
+// served while the engine is thinking.
 class GomocupProtocol final : public Protocol {
 public:
-    GomocupProtocol() = default;
+    GomocupProtocol(Config* config, Controller* controller, std::ostream& output);
+    ~GomocupProtocol() override;
 
     bool HandleRequest(std::istream& request, std::ostream& response) override;
 
 private:
+    // Time reserved for the manager and the pipes on top of the search itself.
+    static constexpr int kSafetyMargin = 15;
+    // The remaining match time is spread over this many moves.
+    static constexpr int kMovesToGo = 20;
+
+    Config* config_;
+    Controller* controller_;
+    SearchThread search_thread_;
+    int width_;
+    int height_;
+    int timeout_turn_;
+    int timeout_match_;
+    int time_left_;
+    int time_used_;
+    // The rule of the last INFO, applied once no search is running.
+    int pending_rule_;
+
+    void HandleStart(int width, int height, std::ostream& response);
+    void HandleTurn(const std::string& args, std::ostream& response);
+    void HandleBegin(std::ostream& response);
+    void HandleBoard(std::istream& request, std::ostream& response);
+    void HandleInfo(const std::string& args, std::ostream& response);
+    void HandleTakeback(const std::string& args, std::ostream& response);
+    void HandleEnd();
+    void HandleAbout(std::ostream& response);
+    void ApplyRule();
+    bool ParseCell(const std::string& args, Cell* cell) const;
+    int GetTimeLimit() const;
+    void StartSearch();
+
     DISALLOW_COPY_AND_ASSIGN(GomocupProtocol);
 };
 
@@ -0,0 +1,150 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "board.h"
+
+namespace asparagus {
+
+// Upper ends of the fill levels in percent of the cells taken.
+static const int kFillLimits[LatencyStats::kFillLevels] = { 10, 25, 50, 100 };
+
+constexpr uint64_t LatencyHistogram::kMaxValue;
+
+LatencyHistogram::LatencyHistogram() {
+    Reset();
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    value = std::min(value, kMaxValue);
+    counts_[GetIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percent) const {
+    const uint64_t total = count();
+    if (!total) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percent / 100.0 * total)));
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(GetLastValue(i), max());
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::PrintSummary(std::ostream& out, const std::string& name) const {
+    out << name << ": count " << count() << " p50 " << GetPercentile(50.0) << " p90 " << GetPercentile(90.0)
+        << " p99 " << GetPercentile(99.0) << " max " << max() << std::endl;
+}
+
+void LatencyHistogram::WriteJson(std::ostream& out) const {
+    out << "{\"count\":" << count() << ",\"max\":" << max() << ",\"p50\":" << GetPercentile(50.0)
+        << ",\"p90\":" << GetPercentile(90.0) << ",\"p99\":" << GetPercentile(99.0) << ",\"buckets\":[";
+    bool is_first = true;
+    for (int i = 0; i < kBuckets; i++) {
+        const uint64_t count = counts_[i].load(std::memory_order_relaxed);
+        if (count) {
+            out << (is_first ? "" : ",") << "[" << GetLastValue(i) << "," << count << "]";
+            is_first = false;
+        }
+    }
+    out << "]}";
+}
+
+int LatencyHistogram::GetIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<int>(value);
+    }
+    unsigned int shift = 0;
+    while (value >> shift >= 2 * kSubBuckets) {
+        shift += 1;
+    }
+    return static_cast<int>((shift + 1) * kSubBuckets + (value >> shift) - kSubBuckets);
+}
+
+uint64_t LatencyHistogram::GetLastValue(int index) {
+    if (index < static_cast<int>(kSubBuckets)) {
+        return index;
+    }
+    const unsigned int shift = index / kSubBuckets - 1;
+    const uint64_t sub_bucket = index % kSubBuckets + kSubBuckets;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyStats::Record(uint64_t value, const Board& board) {
+    all_.Record(value);
+    fill_levels_[GetFillLevel(board)].Record(value);
+}
+
+void LatencyStats::Reset() {
+    all_.Reset();
+    for (auto& histogram : fill_levels_) {
+        histogram.Reset();
+    }
+}
+
+void LatencyStats::PrintSummary(std::ostream& out, const std::string& name) const {
+    all_.PrintSummary(out, " " + name);
+    int from = 0;
+    for (int i = 0; i < kFillLevels; i++) {
+        if (fill_levels_[i].count()) {
+            fill_levels_[i].PrintSummary(
+                out, "  fill " + std::to_string(from) + "-" + std::to_string(kFillLimits[i]) + "%");
+        }
+        from = kFillLimits[i];
+    }
+}
+
+void LatencyStats::WriteJson(std::ostream& out) const {
+    out << "{\"all\":";
+    all_.WriteJson(out);
+    out << ",\"fill\":[";
+    int from = 0;
+    for (int i = 0; i < kFillLevels; i++) {
+        out << (i ? "," : "") << "{\"from\":" << from << ",\"to\":" << kFillLimits[i] << ",\"histogram\":";
+        fill_levels_[i].WriteJson(out);
+        out << "}";
+        from = kFillLimits[i];
+    }
+    out << "]}";
+}
+
+LatencyStats* LatencyStats::process() {
+    static LatencyStats stats;
+    return &stats;
+}
+
+int LatencyStats::GetFillLevel(const Board& board) {
+    int stones = 0;
+    for (int y = 1; y <= board.height(); y++) {
+        for (int x = 1; x <= board.width(); x++) {
+            stones += IsStone(board.stone(MakeCell(x, y)));
+        }
+    }
+    const int percent = 100 * stones / std::max(1, board.width() * board.height());
+    int level = 0;
+    while (level < kFillLevels - 1 && percent >= kFillLimits[level]) {
+        level += 1;
+    }
+    return level;
+}
+
+}  // namespace asparagus
@@ -0,0 +1,82 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_LATENCY_HISTOGRAM_H
+#define ASPARAGUS_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+#include "common.h"
+
+namespace asparagus {
+
+class Board;
+
+// Counts of latencies in microseconds with a bounded relative error, in the
+// manner of HdrHistogram: every power of two is split into kSubBuckets linear
+// buckets. Recording is lock free, so one histogram can be shared by threads.
+class LatencyHistogram final {
+public:
+    static constexpr unsigned int kSubBucketBits = 5;
+    static constexpr unsigned int kSubBuckets = 1u << kSubBucketBits;
+    // Longer latencies are counted as this many microseconds, about 12 days.
+    static constexpr uint64_t kMaxValue = (1ull << 40u) - 1;
+    static constexpr int kBuckets = (40 - kSubBucketBits + 1) * kSubBuckets;
+
+    LatencyHistogram();
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    void Record(uint64_t value);
+    void Reset();
+    // The value below which the given percent of the latencies fall, rounded
+    // up to the end of its bucket.
+    uint64_t GetPercentile(double percent) const;
+    // "<name>: count <n> p50 <us> p90 <us> p99 <us> max <us>"
+    void PrintSummary(std::ostream& out, const std::string& name) const;
+    // {"count":n,"max":us,"p50":us,"p90":us,"p99":us,"buckets":[[<last us>,n],...]}
+    // with the non-empty buckets only.
+    void WriteJson(std::ostream& out) const;
+
+private:
+    std::atomic<uint64_t> counts_[kBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> max_;
+
+    static int GetIndex(uint64_t value);
+    // The largest value counted in the bucket.
+    static uint64_t GetLastValue(int index);
+
+    DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+};
+
+// Latencies of moves in total and by the fill level of the board.
+class LatencyStats final {
+public:
+    static constexpr int kFillLevels = 4;
+
+    LatencyStats() = default;
+
+    void Record(uint64_t value, const Board& board);
+    void Reset();
+    void PrintSummary(std::ostream& out, const std::string& name) const;
+    // {"all":<histogram>,"fill":[{"from":<percent>,"to":<percent>,"histogram":<histogram>},...]}
+    void WriteJson(std::ostream& out) const;
+
+    // Shared by every engine of the process.
+    static LatencyStats* process();
+
+private:
+    LatencyHistogram all_;
+    LatencyHistogram fill_levels_[kFillLevels];
+
+    static int GetFillLevel(const Board& board);
+
+    DISALLOW_COPY_AND_ASSIGN(LatencyStats);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_LATENCY_HISTOGRAM_H
@@ -1,30 +1,91 @@
 // Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
 
 #include <iostream>
+#include <sstream>
 
+#include "batch.h"
 #include "config.h"
 #include "controller.h"
+#include "distributed.h"
+#include "game_log.h"
 #include "gomocup_protocol.h"
+#include "network.h"
+#include "perft.h"
 #include "randoms.h"
+#include "server.h"
 #include "simple_protocol.h"
+#include "solver.h"
 #include "engine.h"
+#include "weights.h"
 
 int main(int argc, char** argv) {
-    asparagus::InitializeRandoms();
     asparagus::Config config;
-    config.Load(argc, argv);
+    std::string bad_argument;
+    if (!config.Load(argc, argv, &bad_argument)) {
+        std::cerr << "error: invalid argument: " << bad_argument << std::endl;
+        return 1;
+    }
+    asparagus::InitializeRandoms(static_cast<uint32_t>(config.seed()));
+    if (!config.weights_file().empty() && !asparagus::Weights::GetPatterns(config.weights_file())) {
+        std::cerr << "error: cannot load weights: " << config.weights_file() << std::endl;
+        return 1;
+    }
+    if (!config.network_file().empty() && !asparagus::Network::Get(config.network_file())) {
+        std::cerr << "error: cannot load network: " << config.network_file() << std::endl;
+        return 1;
+    }
+    if (!config.solver_table_file().empty() &&
+        !asparagus::SolverTable::Get(config.solver_table_file())) {
+        std::cerr << "error: cannot open solver table: " << config.solver_table_file() << std::endl;
+        return 1;
+    }
+    if (config.perft_depth() > 0) {
+        return asparagus::Perft::Run(config, std::cout) ? 0 : 1;
+    }
+    if (!config.batch_file().empty()) {
+        asparagus::BatchAnalyzer analyzer(config);
+        if (!analyzer.Run(config.batch_file(), std::cout)) {
+            std::cerr << "error: cannot open file: " << config.batch_file() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (!config.worker_address().empty()) {
+        asparagus::Worker worker(config);
+        if (!worker.Run(config.worker_address())) {
+            std::cerr << "error: cannot listen on: " << config.worker_address() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    asparagus::GameLog game_log;
+    if (!config.game_log_file().empty() && !game_log.Open(config.game_log_file())) {
+        std::cerr << "error: cannot open game log: " << config.game_log_file() << std::endl;
+        return 1;
+    }
+    if (config.use_server()) {
+        asparagus::Server server(config, &game_log);
+        if (config.server_socket().empty()) {
+            server.Run(std::cin, std::cout);
+        } else if (!server.Run(config.server_socket())) {
+            std::cerr << "error: cannot listen on: " << config.server_socket() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
     asparagus::Engine engine(config);
     asparagus::Controller controller(config, &engine);
+    controller.set_game_log(&game_log);
     asparagus::Protocol* protocol;
     if (config.use_gomocup_protocol()) {
-        protocol = new asparagus::GomocupProtocol();
+        protocol = new asparagus::GomocupProtocol(&config, &controller, std::cout);
     } else {
-        protocol = new asparagus::SimpleProtocol(&config, &controller);
+        protocol = new asparagus::SimpleProtocol(&config, &controller, std::cout);
     }
     while (protocol->is_running()) {
-        if (protocol->HandleRequest(std::cin, std::cout)) {
-            std::cout << std::endl;
-            std::cout.flush();
+        std::ostringstream response;
+        if (protocol->HandleRequest(std::cin, response)) {
+            protocol->Send(response.str());
         }
     }
     delete protocol;
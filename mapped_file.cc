@@ -0,0 +1,81 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "mapped_file.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace asparagus {
+
+MappedFile::MappedFile()
+    :   data_(nullptr),
+        size_(0),
+        is_writable_(false) {}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) || !status.st_size) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, status.st_size, MADV_SEQUENTIAL);
+    data_ = static_cast<uint8_t*>(data);
+    size_ = status.st_size;
+    return true;
+}
+
+bool MappedFile::Create(const std::string& path, size_t size) {
+    Close();
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) || (static_cast<size_t>(status.st_size) < size && ftruncate(fd, size))) {
+        close(fd);
+        return false;
+    }
+    size = std::max(size, static_cast<size_t>(status.st_size));
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(data);
+    size_ = size;
+    is_writable_ = true;
+    return true;
+}
+
+bool MappedFile::Sync() {
+    return !is_writable_ || !msync(data_, size_, MS_SYNC);
+}
+
+void MappedFile::Close() {
+    if (data_) {
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+        is_writable_ = false;
+    }
+}
+
+}  // namespace asparagus
@@ -0,0 +1,42 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_MAPPED_FILE_H
+#define ASPARAGUS_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#include "common.h"
+
+namespace asparagus {
+
+// Memory mapping of a whole file, read-only or shared for writing.
+class MappedFile final {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    constexpr const uint8_t* data() const { return data_; }
+    // Null unless the file was opened with Create.
+    constexpr uint8_t* mutable_data() const { return is_writable_ ? data_ : nullptr; }
+    constexpr size_t size() const { return size_; }
+
+    bool Open(const std::string& path);
+    // Maps the file for writing, a missing file is created and a shorter one is
+    // extended with zeros to the given size. Writes reach the file.
+    bool Create(const std::string& path, size_t size);
+    // Flushes the written pages to the file.
+    bool Sync();
+    void Close();
+
+private:
+    uint8_t* data_;
+    size_t size_;
+    bool is_writable_;
+
+    DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_MAPPED_FILE_H
@@ -0,0 +1,43 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "move_stack.h"
+
+#include <cstring>
+
+namespace asparagus {
+
+void MoveList::Sort() {
+    // Move lists are short and mostly ordered already, an insertion sort is
+    // stable and needs no extra memory.
+    for (int i = 1; i < size_; i++) {
+        const Move move = moves_[i];
+        int j = i;
+        while (j > 0 && moves_[j - 1].score < move.score) {
+            moves_[j] = moves_[j - 1];
+            j -= 1;
+        }
+        moves_[j] = move;
+    }
+}
+
+CellMarker::CellMarker()
+    :   generation_(0) {
+    memset(stamps_, 0, sizeof(stamps_));
+}
+
+void CellMarker::NewGeneration() {
+    generation_ += 1u;
+    if (!generation_) {
+        memset(stamps_, 0, sizeof(stamps_));
+        generation_ = 1u;
+    }
+}
+
+MoveStack::MoveStack()
+    :   storage_(new Move[kMaxPlies * MoveList::kCapacity]) {
+    for (int ply = 0; ply < kMaxPlies; ply++) {
+        lists_[ply].Attach(storage_.get() + ply * MoveList::kCapacity);
+    }
+}
+
+}  // namespace asparagus
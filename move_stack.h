@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_MOVE_STACK_H
+#define ASPARAGUS_MOVE_STACK_H
+
+#include "board.h"
+#include "common.h"
+
+#include <cassert>
+#include <memory>
+
+namespace asparagus {
+
+struct Move {
+    Cell cell;
+    int32_t score;
+};
+
+// The moves of a single ply, a fixed capacity slice of the move stack.
+class MoveList final {
+public:
+    static constexpr int kCapacity = Board::kMaxSize * Board::kMaxSize;
+
+    using iterator = Move*;
+
+    MoveList() : moves_(nullptr), size_(0) {}
+
+    constexpr iterator begin() const { return moves_; }
+    constexpr iterator end() const { return moves_ + size_; }
+    constexpr int size() const { return size_; }
+    constexpr bool empty() const { return !size_; }
+
+    void Attach(Move* storage) {
+        moves_ = storage;
+        size_ = 0;
+    }
+    void clear() { size_ = 0; }
+    void truncate(int size) {
+        assert(size <= size_);
+        size_ = size;
+    }
+    void insert(Cell cell, int32_t score = 0) {
+        assert(size_ < kCapacity);
+        moves_[size_++] = Move{cell, score};
+    }
+    // Orders the moves by descending score, moves of equal score keep their
+    // generation order.
+    void Sort();
+
+private:
+    Move* moves_;
+    int size_;
+
+    DISALLOW_COPY_AND_ASSIGN(MoveList);
+};
+
+// Cells are marked with the current generation, so starting a new scan only
+// bumps the generation instead of clearing the whole board sized array.
+class CellMarker final {
+public:
+    CellMarker();
+
+    bool IsMarked(Cell cell) const { return stamps_[cell] == generation_; }
+    void Mark(Cell cell) { stamps_[cell] = generation_; }
+    void NewGeneration();
+
+private:
+    uint16_t generation_;
+    uint16_t stamps_[Board::kStorageSize];
+
+    DISALLOW_COPY_AND_ASSIGN(CellMarker);
+};
+
+// Preallocated move storage of a search. Only the ply being searched and its
+// ancestors are live, so the touched part of the arena stays small.
+class MoveStack final {
+public:
+    static constexpr int kMaxPlies = 128;
+
+    MoveStack();
+
+    MoveList* moves(int ply) {
+        assert(ply >= 0 && ply < kMaxPlies);
+        MoveList* moves = &lists_[ply];
+        moves->clear();
+        return moves;
+    }
+    CellMarker* marker() { return &marker_; }
+
+private:
+    std::unique_ptr<Move[]> storage_;
+    MoveList lists_[kMaxPlies];
+    CellMarker marker_;
+
+    DISALLOW_COPY_AND_ASSIGN(MoveStack);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_MOVE_STACK_H
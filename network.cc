@@ -0,0 +1,236 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "network.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif  // __AVX2__
+
+namespace asparagus {
+
+static const char kMagic[8] = { 'A', 'S', 'P', 'N', 'N', 'U', 'E', '1' };
+
+constexpr int Network::kActivationScale;
+
+// Rounds to the symmetric range of the type.
+template <typename T>
+static T Round(double value) {
+    const double low = static_cast<double>(std::numeric_limits<T>::min() + 1);
+    const double high = static_cast<double>(std::numeric_limits<T>::max());
+    return static_cast<T>(std::max(low, std::min(high, std::round(value))));
+}
+
+template <typename T>
+static bool Read(const uint8_t** data, const uint8_t* end, T* values, size_t count) {
+    if (static_cast<size_t>(end - *data) < count * sizeof(T)) {
+        return false;
+    }
+    memcpy(values, *data, count * sizeof(T));
+    *data += count * sizeof(T);
+    return true;
+}
+
+template <typename T>
+static void Write(std::ostream& out, const T* values, size_t count) {
+    out.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+}
+
+Network::Parameters::Parameters()
+    :   input_biases(kHidden, 0.0f),
+        input_weights(static_cast<size_t>(kInputs) * kHidden, 0.0f),
+        hidden_biases(kHidden2, 0.0f),
+        hidden_weights(kHidden2 * kHidden, 0.0f),
+        output_bias(0.0f),
+        output_weights(kHidden2, 0.0f),
+        output_scale(1.0f) {}
+
+Network::Network()
+    :   input_weights_(static_cast<size_t>(kInputs) * kHidden, 0),
+        output_bias_(0),
+        output_scale_(1.0f) {
+    memset(input_biases_, 0, sizeof(input_biases_));
+    memset(hidden_biases_, 0, sizeof(hidden_biases_));
+    memset(hidden_weights_, 0, sizeof(hidden_weights_));
+    memset(output_weights_, 0, sizeof(output_weights_));
+}
+
+bool Network::Load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    const std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const uint8_t* data = file.data();
+    const uint8_t* end = data + file.size();
+    char magic[sizeof(kMagic)];
+    return Read(&data, end, magic, sizeof(magic)) && !memcmp(magic, kMagic, sizeof(kMagic)) &&
+           Read(&data, end, &output_scale_, 1) &&
+           Read(&data, end, input_biases_, kHidden) &&
+           Read(&data, end, input_weights_.data(), input_weights_.size()) &&
+           Read(&data, end, hidden_biases_, kHidden2) &&
+           Read(&data, end, &hidden_weights_[0][0], kHidden2 * kHidden) &&
+           Read(&data, end, &output_bias_, 1) &&
+           Read(&data, end, output_weights_, kHidden2) &&
+           data == end;
+}
+
+bool Network::Save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    Write(out, kMagic, sizeof(kMagic));
+    Write(out, &output_scale_, 1);
+    Write(out, input_biases_, kHidden);
+    Write(out, input_weights_.data(), input_weights_.size());
+    Write(out, hidden_biases_, kHidden2);
+    Write(out, &hidden_weights_[0][0], kHidden2 * kHidden);
+    Write(out, &output_bias_, 1);
+    Write(out, output_weights_, kHidden2);
+    return static_cast<bool>(out);
+}
+
+void Network::Quantize(const Parameters& parameters) {
+    constexpr float kBiasScale = static_cast<float>(kActivationScale * kWeightScale);
+    for (int i = 0; i < kHidden; i++) {
+        input_biases_[i] = Round<int16_t>(parameters.input_biases[i] * kActivationScale);
+    }
+    for (size_t i = 0; i < input_weights_.size(); i++) {
+        input_weights_[i] = Round<int16_t>(parameters.input_weights[i] * kActivationScale);
+    }
+    for (int i = 0; i < kHidden2; i++) {
+        hidden_biases_[i] = Round<int32_t>(parameters.hidden_biases[i] * kBiasScale);
+        for (int j = 0; j < kHidden; j++) {
+            hidden_weights_[i][j] = Round<int8_t>(parameters.hidden_weights[i * kHidden + j] * kWeightScale);
+        }
+        output_weights_[i] = Round<int8_t>(parameters.output_weights[i] * kWeightScale);
+    }
+    output_bias_ = Round<int32_t>(parameters.output_bias * kBiasScale);
+    output_scale_ = parameters.output_scale;
+}
+
+float Network::Evaluate(const NetworkAccumulator& accumulator) const {
+    alignas(32) uint8_t hidden[kHidden];
+    int32_t sums[kHidden2];
+    #ifdef __AVX2__
+    // Networks and accumulators live on the heap, which only guarantees 16 byte
+    // alignment, so they are loaded unaligned.
+    const __m256i* values = reinterpret_cast<const __m256i*>(accumulator.values());
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i limit = _mm256_set1_epi16(kActivationScale);
+    for (int i = 0; i < kHidden / 32; i++) {
+        const __m256i low = _mm256_max_epi16(_mm256_min_epi16(_mm256_loadu_si256(values + 2 * i), limit), zero);
+        const __m256i high = _mm256_max_epi16(_mm256_min_epi16(_mm256_loadu_si256(values + 2 * i + 1), limit), zero);
+        // Packing works within the 128 bit lanes, the permute restores the order.
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xd8);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(hidden) + i, packed);
+    }
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int i = 0; i < kHidden2; i++) {
+        const __m256i* weights = reinterpret_cast<const __m256i*>(hidden_weights_[i]);
+        __m256i sum = zero;
+        for (int j = 0; j < kHidden / 32; j++) {
+            // Pairs of products stay below 2 * 127 * 127, well within int16.
+            const __m256i products = _mm256_maddubs_epi16(
+                _mm256_load_si256(reinterpret_cast<const __m256i*>(hidden) + j), _mm256_loadu_si256(weights + j));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        const __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        const __m128i quarter = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+        sums[i] = _mm_cvtsi128_si32(_mm_add_epi32(quarter, _mm_shuffle_epi32(quarter, 0xb1)));
+    }
+    #else  // __AVX2__
+    for (int i = 0; i < kHidden; i++) {
+        hidden[i] = static_cast<uint8_t>(std::max<int>(0, std::min<int>(kActivationScale, accumulator.values()[i])));
+    }
+    for (int i = 0; i < kHidden2; i++) {
+        int32_t sum = 0;
+        for (int j = 0; j < kHidden; j++) {
+            sum += hidden[j] * hidden_weights_[i][j];
+        }
+        sums[i] = sum;
+    }
+    #endif  // __AVX2__
+    int32_t output = output_bias_;
+    for (int i = 0; i < kHidden2; i++) {
+        const int32_t sum = (sums[i] + hidden_biases_[i]) / kWeightScale;
+        const int32_t activation = std::max(0, std::min(kActivationScale, sum));
+        output += activation * output_weights_[i];
+    }
+    return output_scale_ * static_cast<float>(output) / static_cast<float>(kActivationScale * kWeightScale);
+}
+
+const Network* Network::Get(const std::string& path) {
+    // Networks are immutable, every file is loaded once and shared by all
+    // engines. Networks are never freed.
+    static std::mutex mutex;
+    static std::map<std::string, const Network*> networks;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = networks.find(path);
+    if (it != networks.end()) {
+        return it->second;
+    }
+    Network* network = new Network();
+    if (!network->Load(path)) {
+        delete network;
+        return nullptr;
+    }
+    networks[path] = network;
+    return network;
+}
+
+NetworkAccumulator::NetworkAccumulator(const Network* network)
+    :   network_(network) {
+    memset(values_, 0, sizeof(values_));
+}
+
+void NetworkAccumulator::Refresh(const Board& board) {
+    memcpy(values_, network_->input_biases_, sizeof(values_));
+    for (int y = 1; y <= board.height(); y++) {
+        for (int x = 1; x <= board.width(); x++) {
+            const Cell cell = MakeCell(x, y);
+            if (IsStone(board.stone(cell))) {
+                Update(cell, kEmpty, board.stone(cell));
+            }
+        }
+    }
+}
+
+void NetworkAccumulator::Update(Cell cell, Stone old_stone, Stone new_stone) {
+    const int16_t* removed = IsStone(old_stone) ?
+        &network_->input_weights_[Network::GetInput(cell, old_stone) * Network::kHidden] : nullptr;
+    const int16_t* added = IsStone(new_stone) ?
+        &network_->input_weights_[Network::GetInput(cell, new_stone) * Network::kHidden] : nullptr;
+    #ifdef __AVX2__
+    __m256i* values = reinterpret_cast<__m256i*>(values_);
+    for (int i = 0; i < Network::kHidden / 16; i++) {
+        __m256i value = _mm256_loadu_si256(values + i);
+        if (removed) {
+            value = _mm256_sub_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(removed) + i));
+        }
+        if (added) {
+            value = _mm256_add_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(added) + i));
+        }
+        _mm256_storeu_si256(values + i, value);
+    }
+    #else  // __AVX2__
+    if (removed) {
+        for (int i = 0; i < Network::kHidden; i++) {
+            values_[i] -= removed[i];
+        }
+    }
+    if (added) {
+        for (int i = 0; i < Network::kHidden; i++) {
+            values_[i] += added[i];
+        }
+    }
+    #endif  // __AVX2__
+}
+
+}  // namespace asparagus
@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_NETWORK_H
+#define ASPARAGUS_NETWORK_H
+
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "common.h"
+
+namespace asparagus {
+
+class NetworkAccumulator;
+
+// A small quantized network scoring positions from the side of the O stones,
+// an alternative to the pattern evaluation. Inputs are one per cell and colour
+// of stone, the hidden layers have clipped ReLU activations:
+//   kInputs -> kHidden (int16) -> kHidden2 (int8 x int8) -> 1 (int8 x int8)
+// Activations are quantized to 0..kActivationScale, the weights of the hidden
+// and output layers are multiples of 1/kWeightScale.
+//
+// The file is the magic "ASPNNUE1", the float output scale, then the int16
+// input biases and weights (input major), the int32 hidden biases, the int8
+// hidden weights (output major), the int32 output bias and the int8 output
+// weights, all little endian.
+class Network final {
+public:
+    static constexpr int kInputs = 2 * Board::kStorageSize;
+    static constexpr int kHidden = 128;
+    static constexpr int kHidden2 = 32;
+    static constexpr int kActivationScale = 127;
+    static constexpr int kWeightScale = 64;
+
+    // The float network the quantized one is made of, laid out like the file.
+    struct Parameters {
+        Parameters();
+
+        std::vector<float> input_biases;
+        std::vector<float> input_weights;
+        std::vector<float> hidden_biases;
+        std::vector<float> hidden_weights;
+        float output_bias;
+        std::vector<float> output_weights;
+        // Evaluations are the output of the network times the scale.
+        float output_scale;
+    };
+
+    Network();
+
+    static constexpr int GetInput(Cell cell, Stone stone) { return 2 * cell + (stone == kPlayer); }
+
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+    // Rounds the parameters to the quantized weights, the hidden and output
+    // weights are clipped to the int8 range.
+    void Quantize(const Parameters& parameters);
+    float Evaluate(const NetworkAccumulator& accumulator) const;
+
+    // Returns the shared network of the file, nullptr if it cannot be loaded.
+    static const Network* Get(const std::string& path);
+
+private:
+    friend class NetworkAccumulator;
+
+    int16_t input_biases_[kHidden];
+    std::vector<int16_t> input_weights_;
+    int32_t hidden_biases_[kHidden2];
+    int8_t hidden_weights_[kHidden2][kHidden];
+    int32_t output_bias_;
+    int8_t output_weights_[kHidden2];
+    float output_scale_;
+
+    DISALLOW_COPY_AND_ASSIGN(Network);
+};
+
+// The first layer of the network for the stones of a board. A Board with an
+// attached accumulator adds and subtracts the input column of every stone it
+// sets, so the search pays for the first layer one stone at a time.
+class NetworkAccumulator final {
+public:
+    explicit NetworkAccumulator(const Network* network);
+
+    constexpr const Network* network() const { return network_; }
+    constexpr const int16_t* values() const { return values_; }
+
+    // Recomputes the values from the stones of the board.
+    void Refresh(const Board& board);
+    void Update(Cell cell, Stone old_stone, Stone new_stone);
+
+private:
+    int16_t values_[Network::kHidden];
+    const Network* network_;
+
+    DISALLOW_COPY_AND_ASSIGN(NetworkAccumulator);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_NETWORK_H
@@ -0,0 +1,155 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+// Solves small boards exhaustively and checks the engine against the results.
+//
+//   oracle solve <width> <height> <table file> [<table size in MB>] [--threads=<n>]
+//     Solves the empty board and keeps the solved positions in the table. An
+//     interrupted solve resumes from the positions already in the table. The
+//     engine plays from the table with --solver_table=<file>.
+//   oracle check <table file> <positions> [--max_depth=<n> ...]
+//     Lets the engine move in random positions and reports the moves that
+//     lose the value of the position. Positions missing from the table are
+//     solved and added to it.
+//
+// --is_exact_five=1 solves the game where overlines do not win.
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "board.h"
+#include "config.h"
+#include "engine.h"
+#include "randoms.h"
+#include "solver.h"
+
+using namespace asparagus;
+
+constexpr uint64_t kDefaultTableSize = 256;
+
+static int GetThreadCount(const Config& config) {
+    if (config.threads() > 0) {
+        return config.threads();
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+static const char* GetValueName(int value) {
+    return value == Solver::kWin ? "win" : value == Solver::kLoss ? "loss" : "draw";
+}
+
+static int Solve(const Config& config, int width, int height, const std::string& path, uint64_t size) {
+    SolverTable table;
+    if (!table.Create(path, width, height, config.is_exact_five(), size << 20u)) {
+        std::cerr << "error: cannot open table for " << width << "x" << height << ": " << path << std::endl;
+        return 1;
+    }
+    Solver solver(&table, GetThreadCount(config));
+    Board board;
+    board.Initialize(width, height);
+    const auto start_time = std::chrono::steady_clock::now();
+    const Solver::Value value = solver.Solve(board, kEngine);
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+    table.Sync();
+    std::cout << width << "x" << height << ": " << GetValueName(value) << " for the first player"
+              << std::endl
+              << "nodes " << solver.nodes() << " time " << duration.count() << " s"
+              << " entries " << table.CountUsed() << "/" << table.capacity() << std::endl;
+    return 0;
+}
+
+static int Check(const Config& config, const std::string& path, int positions) {
+    SolverTable table;
+    if (!table.Open(path)) {
+        std::cerr << "error: cannot open table: " << path << std::endl;
+        return 1;
+    }
+    const int width = table.width();
+    const int height = table.height();
+    if (!table.Create(path, width, height, config.is_exact_five(), 0)) {
+        std::cerr << "error: table does not match the rules: " << path << std::endl;
+        return 1;
+    }
+    Solver solver(&table, GetThreadCount(config));
+    Engine engine(config);
+    engine.Start();
+    std::mt19937 random(1);
+    int checked = 0;
+    int kept = 0;
+    for (int i = 0; i < positions; i++) {
+        // An even number of random stones, so that the engine moves first.
+        Board board;
+        board.Initialize(width, height);
+        std::uniform_int_distribution<int> stones(0, width * height / 4);
+        const int count = 2 * stones(random);
+        bool is_over = false;
+        for (int j = 0; j < count && !is_over; j++) {
+            Cell cell;
+            do {
+                cell = MakeCell(random() % width + 1, random() % height + 1);
+            } while (board.stone(cell) != kEmpty);
+            const Stone stone = j % 2 ? kEngine : kPlayer;
+            is_over = board.IsTerminalMove(cell, stone, config.is_exact_five());
+            board.Set(cell, stone);
+        }
+        if (is_over) {
+            continue;
+        }
+        const int value = solver.Solve(board, kEngine);
+        const Cell move = engine.GetBestMove(&board);
+        if (!GetX(move)) {
+            continue;
+        }
+        int result = Solver::kWin;
+        if (!board.IsTerminalMove(move, kEngine, config.is_exact_five())) {
+            board.Set(move, kEngine);
+            result = -solver.Solve(board, kPlayer);
+            board.Set(move, kEmpty);
+        }
+        checked += 1;
+        if (result == value) {
+            kept += 1;
+        } else {
+            std::cout << "position " << i << " " << GetValueName(value) << " move " << GetX(move)
+                      << "," << GetY(move) << " " << GetValueName(result) << std::endl;
+        }
+    }
+    table.Sync();
+    std::cout << "checked " << checked << " kept " << kept << " lost " << checked - kept << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    std::string bad_argument;
+    if (!config.Load(argc, argv, &bad_argument)) {
+        std::cerr << "error: invalid argument: " << bad_argument << std::endl;
+        return 1;
+    }
+    InitializeRandoms(static_cast<uint32_t>(config.seed()));
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]).compare(0, 2, "--") != 0) {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() >= 4 && args.size() <= 5 && args[0] == "solve") {
+        const int width = std::stoi(args[1]);
+        const int height = std::stoi(args[2]);
+        if (width < Board::kMinSize || width > Solver::kMaxSize ||
+            height < Board::kMinSize || height > Solver::kMaxSize) {
+            std::cerr << "error: illegal size: " << width << "x" << height << std::endl;
+            return 1;
+        }
+        const uint64_t size = args.size() == 5 ? std::stoull(args[4]) : kDefaultTableSize;
+        return Solve(config, width, height, args[3], size);
+    }
+    if (args.size() == 3 && args[0] == "check") {
+        return Check(config, args[1], std::stoi(args[2]));
+    }
+    std::cerr << "usage: oracle solve <width> <height> <table file> [<table size in MB>]" << std::endl
+              << "       oracle check <table file> <positions>" << std::endl;
+    return 1;
+}
@@ -6,9 +6,10 @@
 
 namespace asparagus {
 
-Patterns::Patterns() {}
+Patterns::Patterns()
+    :   size_(0) {}
 
-void Patterns::AddPattern(const char* pattern, float value) {
+void Patterns::AddPattern(const char* pattern, Score value) {
     Node* node = &root_;
     while (const char ch = *pattern++) {
         unsigned int index;
@@ -27,11 +28,14 @@ void Patterns::AddPattern(const char* pattern, float value) {
         node = node->children_[index];
     }
     node->value_ = value;
+    if (node->index_ == kNoPattern) {
+        node->index_ = size_++;
+    }
 }
 
-float Patterns::GetValue(const Stone* cell, int stride) const {
+Score Patterns::GetValue(const Stone* cell, int stride) const {
     const Node* node = &root_;
-    float value = node->value_;
+    Score value = node->value_;
     while (node && (*cell != kBoundary)) {
         value = node->value_;
         const unsigned int index = *cell & 3u;
@@ -41,9 +45,22 @@ float Patterns::GetValue(const Stone* cell, int stride) const {
     return value;
 }
 
+int Patterns::GetIndex(const Stone* cell, int stride) const {
+    const Node* node = &root_;
+    int index = node->index_;
+    while (node && (*cell != kBoundary)) {
+        index = node->index_;
+        const unsigned int child = *cell & 3u;
+        node = node->children_[child];
+        cell += stride;
+    }
+    return index;
+}
+
 Patterns::Node::Node()
     :   children_{nullptr, nullptr, nullptr, nullptr},
-        value_(kNeutralValue) {}
+        value_(kNeutralValue),
+        index_(kNoPattern) {}
 
 Patterns::Node::~Node() {
     for (auto child : children_) {
@@ -4,17 +4,25 @@
 #define ASPARAGUS_PATTERNS_H
 
 #include "common.h"
+#include "score.h"
 
 namespace asparagus {
 
 class Patterns final {
 public:
-    static constexpr float kNeutralValue = 0.0f;
+    static constexpr Score kNeutralValue = 0;
+
+    static constexpr int kNoPattern = -1;
 
     Patterns();
 
-    void AddPattern(const char* pattern, float value);
-    float GetValue(const Stone* cell, int stride) const;
+    // Number of distinct patterns, they are indexed in the order of addition.
+    constexpr int size() const { return size_; }
+
+    void AddPattern(const char* pattern, Score value);
+    Score GetValue(const Stone* cell, int stride) const;
+    // Index of the pattern GetValue would take the value of, or kNoPattern.
+    int GetIndex(const Stone* cell, int stride) const;
 
 private:
     struct Node {
@@ -22,13 +30,16 @@ private:
         ~Node();
 
         Node* children_[4];
-        float value_;
+        Score value_;
+        int index_;
 
     private:
         DISALLOW_COPY_AND_ASSIGN(Node);
     };
 
     Node root_;
+    int size_;
+
     DISALLOW_COPY_AND_ASSIGN(Patterns);
 };
 
@@ -0,0 +1,192 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "perft.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "config.h"
+
+namespace asparagus {
+
+static void CopyBoard(const Board& board, Board* copy) {
+    copy->Initialize(board.width(), board.height());
+    for (int y = 1; y <= board.height(); y++) {
+        for (int x = 1; x <= board.width(); x++) {
+            const Cell cell = MakeCell(x, y);
+            if (IsStone(board.stone(cell))) {
+                copy->Set(cell, board.stone(cell));
+            }
+        }
+    }
+    copy->SetRenju(board.black());
+}
+
+Perft::Perft(int distance, bool is_exact_five, bool use_reference)
+    :   distance_(distance),
+        is_exact_five_(is_exact_five),
+        use_reference_(use_reference) {}
+
+uint64_t Perft::Count(Board* board, Stone stone, int depth) {
+    if (depth <= 0) {
+        return 1;
+    }
+    assert(depth < MoveStack::kMaxPlies);
+    MoveList* moves = move_stack_.moves(depth);
+    GetMoves(*board, stone, moves);
+    if (depth == 1) {
+        return moves->size();
+    }
+    uint64_t leaves = 0;
+    for (const auto& move : *moves) {
+        if (board->IsTerminalMove(move.cell, stone, is_exact_five_)) {
+            leaves += 1;
+            continue;
+        }
+        board->Set(move.cell, stone);
+        leaves += Count(board, stone ^ kForbidden, depth - 1);
+        board->Set(move.cell, kEmpty);
+    }
+    return leaves;
+}
+
+uint64_t Perft::Count(const Board& board, Stone stone, int depth, int distance, bool is_exact_five,
+                      bool use_reference, int threads) {
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    Perft root(distance, is_exact_five, use_reference);
+    if (threads == 1 || depth <= 1) {
+        Board copy;
+        CopyBoard(board, &copy);
+        return root.Count(&copy, stone, depth);
+    }
+
+    MoveList* moves = root.move_stack_.moves(0);
+    root.GetMoves(board, stone, moves);
+    std::atomic<int> next(0);
+    std::atomic<uint64_t> leaves(0);
+    auto work = [&]() {
+        Board copy;
+        CopyBoard(board, &copy);
+        Perft perft(distance, is_exact_five, use_reference);
+        for (int i = next++; i < moves->size(); i = next++) {
+            const Cell move = moves->begin()[i].cell;
+            if (copy.IsTerminalMove(move, stone, is_exact_five)) {
+                leaves += 1;
+                continue;
+            }
+            copy.Set(move, stone);
+            leaves += perft.Count(&copy, stone ^ kForbidden, depth - 1);
+            copy.Set(move, kEmpty);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(work);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return leaves;
+}
+
+bool Perft::Run(const Config& config, std::ostream& out) {
+    std::vector<std::string> positions;
+    if (config.batch_file().empty()) {
+        positions.push_back("15");
+    } else {
+        std::ifstream in(config.batch_file());
+        if (!in) {
+            std::cerr << "error: cannot open file: " << config.batch_file() << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos && line[0] != '#') {
+                positions.push_back(line);
+            }
+        }
+    }
+    bool is_correct = true;
+    uint64_t total = 0;
+    const auto start_time = std::chrono::steady_clock::now();
+    for (const auto& position : positions) {
+        Board board;
+        if (!BatchAnalyzer::ParsePosition(position, &board)) {
+            out << "error: bad position" << std::endl;
+            continue;
+        }
+        const uint64_t leaves = Count(board, kEngine, config.perft_depth(), config.perft_distance(),
+                                      config.is_exact_five(), false, config.threads());
+        total += leaves;
+        out << leaves << " leaves";
+        if (config.perft_check()) {
+            const uint64_t reference = Count(board, kEngine, config.perft_depth(), config.perft_distance(),
+                                             config.is_exact_five(), true, config.threads());
+            out << " reference " << reference << (leaves == reference ? "" : " MISMATCH");
+            is_correct = is_correct && leaves == reference;
+        }
+        out << std::endl;
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+    out << "counted " << total << " leaves of " << positions.size() << " positions in " << duration.count()
+              << " s (" << static_cast<double>(total) / duration.count() << " leaves/sec)" << std::endl;
+    return is_correct;
+}
+
+void Perft::GetMoves(const Board& board, Stone stone, MoveList* moves) {
+    if (board.empty()) {
+        moves->insert(MakeCell(board.width() / 2, board.height() / 2));
+        return;
+    }
+    if (use_reference_) {
+        GetReferenceMoves(board, moves);
+    } else {
+        board.GetPossibleMoves(distance_, move_stack_.marker(), moves);
+    }
+    if (stone == board.black()) {
+        int size = 0;
+        for (const auto& move : *moves) {
+            if (!board.IsForbidden(move.cell)) {
+                moves->begin()[size++] = move;
+            }
+        }
+        moves->truncate(size);
+    }
+}
+
+void Perft::GetReferenceMoves(const Board& board, MoveList* moves) const {
+    static const int kDirections[8][2] = {
+        { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 },
+    };
+    for (int y = 1; y <= board.height(); y++) {
+        for (int x = 1; x <= board.width(); x++) {
+            const Cell cell = MakeCell(x, y);
+            if (!board.IsEmptyCell(cell)) {
+                continue;
+            }
+            bool is_near = false;
+            for (const auto& direction : kDirections) {
+                for (int i = 1; i <= distance_ && !is_near; i++) {
+                    const int near_x = x + i * direction[0];
+                    const int near_y = y + i * direction[1];
+                    is_near = near_x > 0 && near_y > 0 && near_x <= board.width() && near_y <= board.height() &&
+                              IsStone(board.stone(MakeCell(near_x, near_y)));
+                }
+            }
+            if (is_near) {
+                moves->insert(cell);
+            }
+        }
+    }
+}
+
+}  // namespace asparagus
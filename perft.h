@@ -0,0 +1,57 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_PERFT_H
+#define ASPARAGUS_PERFT_H
+
+#include <ostream>
+
+#include "board.h"
+#include "common.h"
+#include "move_stack.h"
+
+namespace asparagus {
+
+class Config;
+
+// Counts the leaves of the move generation tree. The moves of a node are those
+// of Board::GetPossibleMoves within the distance, less the forbidden cells of
+// the restricted colour under Renju. A move making five ends the game, so it is
+// a leaf at any depth. An empty board has the single opening move of the engine.
+//
+// The counts check changes of the move generation and of Board::Set against the
+// reference generator, and time the raw speed of both.
+class Perft final {
+public:
+    Perft(int distance, bool is_exact_five, bool use_reference = false);
+
+    // The leaves under the position with the stone to move, depth 0 is the
+    // position itself. The board is restored before returning.
+    uint64_t Count(Board* board, Stone stone, int depth);
+
+    // Splits the root moves between the threads, each searches its own copy of
+    // the board. Zero threads use every core.
+    static uint64_t Count(const Board& board, Stone stone, int depth, int distance, bool is_exact_five,
+                          bool use_reference, int threads);
+
+    // The command line mode: counts the positions of the batch file, one per
+    // line in the text format of BatchAnalyzer, or the empty 15x15 board without
+    // one. Prints "<leaves> leaves" per position, with the reference count too
+    // when checking. Returns false if the file cannot be read or a count differs.
+    static bool Run(const Config& config, std::ostream& out);
+
+private:
+    const int distance_;
+    const bool is_exact_five_;
+    const bool use_reference_;
+    MoveStack move_stack_;
+
+    void GetMoves(const Board& board, Stone stone, MoveList* moves);
+    // Collects the same moves cell by cell with Board::IsEmptyCell.
+    void GetReferenceMoves(const Board& board, MoveList* moves) const;
+
+    DISALLOW_COPY_AND_ASSIGN(Perft);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_PERFT_H
@@ -0,0 +1,143 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "position_stream.h"
+
+#include <cstring>
+
+#include "board.h"
+
+namespace asparagus {
+
+static const char kMagic[4] = { 'A', 'P', 'O', 'S' };
+
+bool PositionStream::IsHeader(const uint8_t* data, size_t size) {
+    return size >= kHeaderSize && !memcmp(data, kMagic, sizeof(kMagic)) && data[4] == kVersion;
+}
+
+void PositionStream::WriteHeader(uint8_t* data) {
+    memset(data, 0, kHeaderSize);
+    memcpy(data, kMagic, sizeof(kMagic));
+    data[4] = kVersion;
+}
+
+size_t PositionStream::GetRecordSize(int width, int height) {
+    return kRecordHeaderSize + (width * height + 3) / 4;
+}
+
+size_t PositionStream::Decode(const uint8_t* data, size_t size, Board* board, Stone* to_move) {
+    if (size < kRecordHeaderSize) {
+        return 0;
+    }
+    const int width = data[0];
+    const int height = data[1];
+    if (width < Board::kMinSize || width > Board::kMaxSize ||
+        height < Board::kMinSize || height > Board::kMaxSize) {
+        return 0;
+    }
+    const size_t record_size = GetRecordSize(width, height);
+    if (size < record_size) {
+        return 0;
+    }
+    const Stone side = data[2];
+    if (side != kEngine && side != kPlayer) {
+        return 0;
+    }
+    // Only empty cells and stones are stored, a forbidden cell is no position.
+    const uint8_t* cells = data + kRecordHeaderSize;
+    const unsigned int cell_count = width * height;
+    for (unsigned int index = 0; index < cell_count; index++) {
+        if (((cells[index >> 2u] >> ((index & 3u) << 1u)) & 3u) == kForbidden) {
+            return 0;
+        }
+    }
+    *to_move = side;
+    if (board->width() == width && board->height() == height) {
+        board->Clear();
+    } else {
+        board->Initialize(width, height);
+    }
+    unsigned int index = 0;
+    for (int y = 1; y <= height; y++) {
+        for (int x = 1; x <= width; x++, index++) {
+            const Stone stone = (cells[index >> 2u] >> ((index & 3u) << 1u)) & 3u;
+            if (stone) {
+                board->Set(MakeCell(x, y), stone);
+            }
+        }
+    }
+    return record_size;
+}
+
+void PositionStream::Encode(const Board& board, Stone to_move, std::vector<uint8_t>* record) {
+    const int width = board.width();
+    const int height = board.height();
+    record->assign(GetRecordSize(width, height), 0);
+    uint8_t* data = record->data();
+    data[0] = width;
+    data[1] = height;
+    data[2] = to_move;
+    uint8_t* cells = data + kRecordHeaderSize;
+    unsigned int index = 0;
+    for (int y = 1; y <= height; y++) {
+        for (int x = 1; x <= width; x++, index++) {
+            cells[index >> 2u] |= (board.stone(MakeCell(x, y)) & 3u) << ((index & 3u) << 1u);
+        }
+    }
+}
+
+PositionReader::PositionReader(std::istream& in)
+    :   in_(&in),
+        data_(nullptr),
+        size_(0) {
+    uint8_t header[PositionStream::kHeaderSize];
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    is_valid_ = in && PositionStream::IsHeader(header, sizeof(header));
+}
+
+PositionReader::PositionReader(const uint8_t* data, size_t size)
+    :   in_(nullptr),
+        data_(data),
+        size_(size) {
+    is_valid_ = PositionStream::IsHeader(data, size);
+    if (is_valid_) {
+        data_ += PositionStream::kHeaderSize;
+        size_ -= PositionStream::kHeaderSize;
+    }
+}
+
+bool PositionReader::Read(Board* board, Stone* to_move) {
+    if (!is_valid_) {
+        return false;
+    }
+    if (!in_) {
+        const size_t record_size = PositionStream::Decode(data_, size_, board, to_move);
+        data_ += record_size;
+        size_ -= record_size;
+        is_valid_ = record_size != 0;
+        return is_valid_;
+    }
+    buffer_.resize(PositionStream::kRecordHeaderSize);
+    if (!in_->read(reinterpret_cast<char*>(buffer_.data()), PositionStream::kRecordHeaderSize)) {
+        is_valid_ = false;
+        return false;
+    }
+    buffer_.resize(PositionStream::GetRecordSize(buffer_[0], buffer_[1]));
+    const size_t cells_size = buffer_.size() - PositionStream::kRecordHeaderSize;
+    in_->read(reinterpret_cast<char*>(buffer_.data()) + PositionStream::kRecordHeaderSize, cells_size);
+    is_valid_ = !in_->fail() && PositionStream::Decode(buffer_.data(), buffer_.size(), board, to_move);
+    return is_valid_;
+}
+
+PositionWriter::PositionWriter(std::ostream& out)
+    :   out_(out) {
+    uint8_t header[PositionStream::kHeaderSize];
+    PositionStream::WriteHeader(header);
+    out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+void PositionWriter::Write(const Board& board, Stone to_move) {
+    PositionStream::Encode(board, to_move, &buffer_);
+    out_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+}
+
+}  // namespace asparagus
@@ -0,0 +1,77 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_POSITION_STREAM_H
+#define ASPARAGUS_POSITION_STREAM_H
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "common.h"
+
+namespace asparagus {
+
+class Board;
+
+// Compact binary position records for bulk I/O. A stream starts with an 8 byte
+// header ("APOS", version, 3 reserved bytes) followed by records of
+//   width (1 byte), height (1 byte), side to move (1 byte),
+//   width * height cells, 2 bits each, row major, least significant bits first.
+// Cells hold the stone values of common.h masked to 2 bits. Records with a
+// forbidden cell, or a side to move other than kEngine or kPlayer, are invalid.
+class PositionStream final {
+public:
+    static constexpr int kHeaderSize = 8;
+    static constexpr int kRecordHeaderSize = 3;
+    static constexpr uint8_t kVersion = 1;
+
+    static bool IsHeader(const uint8_t* data, size_t size);
+    static void WriteHeader(uint8_t* data);
+    static size_t GetRecordSize(int width, int height);
+
+    // Decodes a single record into the board, returns the size of the record or 0
+    // if the record is invalid or truncated.
+    static size_t Decode(const uint8_t* data, size_t size, Board* board, Stone* to_move);
+    static void Encode(const Board& board, Stone to_move, std::vector<uint8_t>* record);
+
+private:
+    PositionStream() = delete;
+};
+
+// Reads records either from a stream (pipes, files) or directly from memory, for
+// example from a MappedFile, without copying.
+class PositionReader final {
+public:
+    explicit PositionReader(std::istream& in);
+    PositionReader(const uint8_t* data, size_t size);
+
+    constexpr bool is_valid() const { return is_valid_; }
+
+    bool Read(Board* board, Stone* to_move);
+
+private:
+    std::istream* in_;
+    const uint8_t* data_;
+    size_t size_;
+    bool is_valid_;
+    std::vector<uint8_t> buffer_;
+
+    DISALLOW_COPY_AND_ASSIGN(PositionReader);
+};
+
+class PositionWriter final {
+public:
+    explicit PositionWriter(std::ostream& out);
+
+    void Write(const Board& board, Stone to_move);
+
+private:
+    std::ostream& out_;
+    std::vector<uint8_t> buffer_;
+
+    DISALLOW_COPY_AND_ASSIGN(PositionWriter);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_POSITION_STREAM_H
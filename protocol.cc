@@ -4,11 +4,18 @@
 
 namespace asparagus {
 
-Protocol::Protocol()
-    :   is_running_(true) {}
+Protocol::Protocol(std::ostream& output)
+    :   is_running_(true),
+        output_(output) {}
 
 void Protocol::Quit() {
     is_running_ = false;
 }
 
+void Protocol::Send(const std::string& message) {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    output_ << message << std::endl;
+    output_.flush();
+}
+
 }  // namespace asparagus
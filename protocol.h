@@ -4,7 +4,9 @@
 #define ASPARAGUS_PROTOCOL_H
 
 #include <istream>
+#include <mutex>
 #include <ostream>
+#include <string>
 
 #include "common.h"
 
@@ -12,17 +14,21 @@ namespace asparagus {
 
 class Protocol {
 public:
-    Protocol();
+    explicit Protocol(std::ostream& output);
     virtual ~Protocol() = default;
 
     constexpr bool is_running() const { return is_running_; }
 
     void Quit();
+    // Writes a line of response. Safe to call from search threads as well.
+    void Send(const std::string& message);
 
     virtual bool HandleRequest(std::istream& request, std::ostream& response) = 0;
 
 private:
     bool is_running_;
+    std::ostream& output_;
+    std::mutex output_mutex_;
 
     DISALLOW_COPY_AND_ASSIGN(Protocol);
 };
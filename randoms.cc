@@ -5,18 +5,21 @@
 
 namespace asparagus {
 
-static std::random_device device;
-static std::mt19937_64 generator(device());
-static std::uniform_int_distribution<uint64_t> distribution;
-
 uint64_t kRandoms[1024][4];
 
-void InitializeRandoms() {
+void InitializeRandoms(uint64_t seed) {
+    if (!seed) {
+        std::random_device device;
+        seed = device();
+    }
+    // The output of the engine itself is fixed by the standard, unlike the
+    // distributions.
+    std::mt19937_64 generator(seed);
     for (auto & randoms : kRandoms) {
         randoms[0] = 0;
-        randoms[1] = distribution(generator);
-        randoms[2] = distribution(generator);
-        randoms[3] = distribution(generator);
+        randoms[1] = generator();
+        randoms[2] = generator();
+        randoms[3] = generator();
     }
 }
 
@@ -9,7 +9,8 @@ namespace asparagus {
 
 extern uint64_t kRandoms[1024][4];
 
-void InitializeRandoms();
+// The same seed gives the same keys, zero seeds from the random device.
+void InitializeRandoms(uint64_t seed = 0);
 
 }  // namespace asparagus
 
@@ -0,0 +1,49 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_SCORE_H
+#define ASPARAGUS_SCORE_H
+
+#include "common.h"
+
+namespace asparagus {
+
+// Evaluations and search values are integers. Evaluations stay within
+// kMaxEvaluation, far below the wins. A win in n plies from the root of the
+// search scores kWinScore - n, so the search prefers quick wins and slow
+// losses, kInfinity is beyond every score.
+using Score = int32_t;
+
+constexpr Score kWinScore = 1000000000;
+constexpr Score kInfinity = kWinScore + 1;
+// Longer wins are never searched.
+constexpr int kMaxWinPlies = 256;
+constexpr Score kMinWinScore = kWinScore - kMaxWinPlies;
+constexpr Score kMaxEvaluation = kWinScore / 2;
+// A board has at most four pattern values per cell, so their sums can never
+// overflow when the values are limited to this.
+constexpr Score kMaxPatternValue = 1 << 19;
+
+constexpr Score GetWinScore(int ply) { return kWinScore - ply; }
+constexpr bool IsWinScore(Score score) { return score >= kMinWinScore || score <= -kMinWinScore; }
+
+constexpr Score ClampEvaluation(int64_t value) {
+    return static_cast<Score>(value > kMaxEvaluation ? kMaxEvaluation :
+                              value < -kMaxEvaluation ? -kMaxEvaluation : value);
+}
+
+// The cache counts the plies of a win from the position it stores, so the
+// entry holds wherever the position turns up in the tree. These convert a
+// score between the two for a node at the given ply, infinities stay.
+constexpr Score ToNodeScore(Score score, int ply) {
+    return score >= kMinWinScore && score <= kWinScore ? score + ply :
+           score <= -kMinWinScore && score >= -kWinScore ? score - ply : score;
+}
+
+constexpr Score FromNodeScore(Score score, int ply) {
+    return score >= kMinWinScore && score <= kWinScore ? score - ply :
+           score <= -kMinWinScore && score >= -kWinScore ? score + ply : score;
+}
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_SCORE_H
@@ -0,0 +1,49 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "search_pool.h"
+
+namespace asparagus {
+
+SearchPool::SearchPool(int thread_count)
+    :   is_running_(true) {
+    for (int i = 0; i < thread_count; i++) {
+        threads_.emplace_back(&SearchPool::Work, this);
+    }
+}
+
+SearchPool::~SearchPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        is_running_ = false;
+    }
+    ready_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void SearchPool::Submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    ready_.notify_one();
+}
+
+void SearchPool::Work() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this]() { return !tasks_.empty() || !is_running_; });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+}  // namespace asparagus
@@ -0,0 +1,42 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_SEARCH_POOL_H
+#define ASPARAGUS_SEARCH_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+
+namespace asparagus {
+
+// A fixed number of threads running searches in submission order. As every
+// session has at most one search in flight, the queue is served round robin.
+class SearchPool final {
+public:
+    using Task = std::function<void()>;
+
+    explicit SearchPool(int thread_count);
+    ~SearchPool();
+
+    void Submit(Task task);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Task> tasks_;
+    bool is_running_;
+    std::vector<std::thread> threads_;
+
+    void Work();
+
+    DISALLOW_COPY_AND_ASSIGN(SearchPool);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_SEARCH_POOL_H
@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "search_recorder.h"
+
+#include <cstring>
+
+#include "mapped_file.h"
+
+namespace asparagus {
+
+static const char kMagic[4] = { 'A', 'S', 'T', 'R' };
+static constexpr uint8_t kVersion = 2;
+
+constexpr uint8_t SearchRecorder::kTruncated;
+constexpr uint8_t SearchRecorder::kLeft;
+
+SearchRecorder::SearchRecorder()
+    :   is_armed_(false),
+        is_recording_(false),
+        is_truncated_(false),
+        max_nodes_(0),
+        max_ply_(0) {}
+
+bool SearchRecorder::Arm(const std::string& path, uint64_t max_nodes, int max_ply) {
+    Disarm();
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_) {
+        return false;
+    }
+    is_armed_ = true;
+    max_nodes_ = max_nodes;
+    max_ply_ = max_ply;
+    return true;
+}
+
+void SearchRecorder::Disarm() {
+    if (out_.is_open()) {
+        out_.close();
+    }
+    is_armed_ = false;
+    is_recording_ = false;
+}
+
+void SearchRecorder::Begin() {
+    if (!is_armed_) {
+        return;
+    }
+    nodes_.clear();
+    is_truncated_ = false;
+    is_recording_ = true;
+}
+
+void SearchRecorder::End() {
+    if (!is_recording_) {
+        return;
+    }
+    uint8_t header[kHeaderSize] = {};
+    memcpy(header, kMagic, sizeof(kMagic));
+    header[4] = kVersion;
+    header[5] = is_truncated_ ? kTruncated : 0;
+    const uint32_t count = static_cast<uint32_t>(nodes_.size());
+    memcpy(header + 8, &count, sizeof(count));
+    out_.write(reinterpret_cast<const char*>(header), kHeaderSize);
+    out_.write(reinterpret_cast<const char*>(nodes_.data()), nodes_.size() * sizeof(Node));
+    nodes_.clear();
+    nodes_.shrink_to_fit();
+    Disarm();
+}
+
+int32_t SearchRecorder::Add(uint64_t hash, Cell move, int ply, int depth, Score alpha, Score beta) {
+    if (ply > max_ply_) {
+        return kNone;
+    }
+    if (nodes_.size() >= max_nodes_) {
+        is_truncated_ = true;
+        return kNone;
+    }
+    Node node;
+    node.hash = hash;
+    node.alpha = alpha;
+    node.beta = beta;
+    node.value = 0;
+    node.move = move;
+    node.best_move = 0;
+    node.moves = 0;
+    node.cutoff = -1;
+    node.ply = static_cast<uint8_t>(ply);
+    node.depth = static_cast<uint8_t>(depth);
+    node.cache = kCacheMiss;
+    node.flags = 0;
+    nodes_.push_back(node);
+    return static_cast<int32_t>(nodes_.size() - 1);
+}
+
+bool SearchRecorder::Load(const std::string& path, std::vector<Node>* nodes, bool* is_truncated) {
+    MappedFile file;
+    if (!file.Open(path) || file.size() < kHeaderSize ||
+        memcmp(file.data(), kMagic, sizeof(kMagic)) || file.data()[4] != kVersion) {
+        return false;
+    }
+    uint32_t count;
+    memcpy(&count, file.data() + 8, sizeof(count));
+    if (file.size() != kHeaderSize + static_cast<size_t>(count) * sizeof(Node)) {
+        return false;
+    }
+    *is_truncated = file.data()[5] & kTruncated;
+    nodes->resize(count);
+    memcpy(nodes->data(), file.data() + kHeaderSize, count * sizeof(Node));
+    return true;
+}
+
+}  // namespace asparagus
@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_SEARCH_RECORDER_H
+#define ASPARAGUS_SEARCH_RECORDER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "score.h"
+
+namespace asparagus {
+
+// Records the tree searched by a single GetBestMove call for offline analysis
+// of the pruning, see treestat. Only the nodes of the main search are recorded,
+// the quiescence search shows as the values it returns to the last ply. The
+// recorder is armed for the next search and writes the file when it ends, the
+// nodes over the budget or beyond the ply limit are left out.
+//
+// The file is the magic "ASTR", a version byte, a flags byte (kTruncated), two
+// reserved bytes and the uint32 number of nodes, then the nodes in preorder as
+// laid out in Node, all little endian.
+class SearchRecorder final {
+public:
+    enum CacheOutcome : uint8_t {
+        kCacheMiss,
+        // Found, but searched shallower than needed, only its move is used.
+        kCacheShallow,
+        // Deep enough, its bound narrowed the window or had no effect.
+        kCacheBound,
+        // Answered the node without a search.
+        kCacheCutoff,
+    };
+    // Flags of the file.
+    static constexpr uint8_t kTruncated = 1u;
+    // Flags of a node, nodes of an aborted search are never left.
+    static constexpr uint8_t kLeft = 1u;
+    static constexpr int32_t kNone = -1;
+    static constexpr size_t kHeaderSize = 12;
+
+    struct Node {
+        uint64_t hash;
+        // The window at entry and the value returned, both from the side to
+        // move at the node.
+        Score alpha;
+        Score beta;
+        Score value;
+        // The move that led to the node, zero at the root.
+        uint16_t move;
+        uint16_t best_move;
+        // The moves searched and the index of the one failing high, -1 if none.
+        uint16_t moves;
+        int16_t cutoff;
+        uint8_t ply;
+        uint8_t depth;
+        uint8_t cache;
+        uint8_t flags;
+    };
+    static_assert(sizeof(Node) == 32, "nodes are written as they are");
+
+    SearchRecorder();
+
+    constexpr bool is_recording() const { return is_recording_; }
+
+    // Records the next search into the file. Returns false if the file cannot
+    // be created.
+    bool Arm(const std::string& path, uint64_t max_nodes, int max_ply);
+    void Disarm();
+    // The search calls Begin and End, the file is written by End.
+    void Begin();
+    void End();
+
+    // Returns the index of the node for Leave, kNone if it is not recorded.
+    int32_t Enter(uint64_t hash, Cell move, int ply, int depth, Score alpha, Score beta) {
+        if (!is_recording_) {
+            return kNone;
+        }
+        return Add(hash, move, ply, depth, alpha, beta);
+    }
+    void Leave(int32_t index, Score value, Cell best_move, uint8_t cache, int moves, int cutoff) {
+        if (index != kNone) {
+            Node& node = nodes_[index];
+            node.value = value;
+            node.best_move = best_move;
+            node.cache = cache;
+            node.moves = static_cast<uint16_t>(moves);
+            node.cutoff = static_cast<int16_t>(cutoff);
+            node.flags |= kLeft;
+        }
+    }
+
+    // Reads a recorded file, returns false if it is damaged.
+    static bool Load(const std::string& path, std::vector<Node>* nodes, bool* is_truncated);
+
+private:
+    std::ofstream out_;
+    bool is_armed_;
+    bool is_recording_;
+    bool is_truncated_;
+    uint64_t max_nodes_;
+    int max_ply_;
+    std::vector<Node> nodes_;
+
+    int32_t Add(uint64_t hash, Cell move, int ply, int depth, Score alpha, Score beta);
+
+    DISALLOW_COPY_AND_ASSIGN(SearchRecorder);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_SEARCH_RECORDER_H
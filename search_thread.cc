@@ -0,0 +1,55 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "search_thread.h"
+
+#include "controller.h"
+#include "search_pool.h"
+
+namespace asparagus {
+
+SearchThread::SearchThread(Controller* controller, SearchPool* pool)
+    :   controller_(controller),
+        pool_(pool),
+        stop_(false),
+        is_searching_(false),
+        is_running_(false) {}
+
+SearchThread::~SearchThread() {
+    Stop();
+    Wait();
+}
+
+void SearchThread::Start(SearchControl control, Callback callback) {
+    Wait();
+    stop_.store(false, std::memory_order_relaxed);
+    is_searching_.store(true, std::memory_order_release);
+    is_running_ = true;
+    control.stop = &stop_;
+    auto task = [this, control, callback]() {
+        const Cell move = controller_->GetEngineMove(&control);
+        is_searching_.store(false, std::memory_order_release);
+        callback(move);
+        std::lock_guard<std::mutex> lock(mutex_);
+        is_running_ = false;
+        finished_.notify_all();
+    };
+    if (pool_) {
+        pool_->Submit(task);
+    } else {
+        thread_ = std::thread(task);
+    }
+}
+
+void SearchThread::Stop() {
+    stop_.store(true, std::memory_order_relaxed);
+}
+
+void SearchThread::Wait() {
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this]() { return !is_running_; });
+}
+
+}  // namespace asparagus
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_SEARCH_THREAD_H
+#define ASPARAGUS_SEARCH_THREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "common.h"
+#include "engine.h"
+
+namespace asparagus {
+
+class Controller;
+class SearchPool;
+
+// Runs Controller::GetEngineMove in the background so that the protocol can keep
+// reading requests while the engine is thinking. The search gets a thread of its
+// own, or is queued on a shared SearchPool when one is given. The controller must
+// not be touched by anyone else until the search is finished.
+class SearchThread final {
+public:
+    using Callback = std::function<void(Cell move)>;
+
+    explicit SearchThread(Controller* controller, SearchPool* pool = nullptr);
+    ~SearchThread();
+
+    // Turns false before the callback runs, so that the answer can be followed
+    // at once. Wait() also waits for the callback.
+    bool is_searching() const { return is_searching_.load(std::memory_order_acquire); }
+
+    void Start(SearchControl control, Callback callback);
+    void Stop();
+    void Wait();
+
+private:
+    Controller* controller_;
+    SearchPool* pool_;
+    std::thread thread_;
+    std::atomic<bool> stop_;
+    std::atomic<bool> is_searching_;
+    std::mutex mutex_;
+    std::condition_variable finished_;
+    bool is_running_;
+
+    DISALLOW_COPY_AND_ASSIGN(SearchThread);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_SEARCH_THREAD_H
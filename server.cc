@@ -0,0 +1,183 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "server.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "config.h"
+#include "controller.h"
+#include "engine.h"
+#include "simple_protocol.h"
+
+namespace asparagus {
+
+// Hands the collected output over to a sink on every flush.
+class SinkBuffer final : public std::stringbuf {
+public:
+    using Sink = std::function<void(const std::string&)>;
+
+    explicit SinkBuffer(Sink sink) : sink_(std::move(sink)) {}
+
+protected:
+    int sync() override {
+        sink_(str());
+        str(std::string());
+        return 0;
+    }
+
+private:
+    Sink sink_;
+};
+
+static int GetPoolSize(const Config& config) {
+    return config.threads() > 0 ? config.threads() : std::max(1u, std::thread::hardware_concurrency());
+}
+
+static Config GetSessionConfig(const Config& defaults) {
+    Config config = defaults;
+    config.Set("cache_size", defaults.session_cache_size());
+    return config;
+}
+
+struct Server::Session {
+    Session(const Config& defaults, SinkBuffer::Sink sink, SearchPool* pool, GameLog* game_log)
+        :   config(GetSessionConfig(defaults)),
+            buffer(std::move(sink)),
+            engine(config),
+            controller(config, &engine),
+            output(&buffer),
+            protocol(&config, &controller, output, pool, defaults.session_time_limit()) {
+        controller.set_game_log(game_log);
+    }
+
+    Config config;
+    SinkBuffer buffer;
+    Engine engine;
+    Controller controller;
+    std::ostream output;
+    SimpleProtocol protocol;
+
+    void HandleRequest(const std::string& line) {
+        std::istringstream request(line);
+        std::ostringstream response;
+        if (protocol.HandleRequest(request, response)) {
+            protocol.Send(response.str());
+        }
+    }
+};
+
+Server::Server(const Config& config, GameLog* game_log)
+    :   config_(config),
+        game_log_(game_log),
+        pool_(GetPoolSize(config)) {}
+
+Server::~Server() = default;
+
+void Server::Run(std::istream& in, std::ostream& out) {
+    std::map<std::string, std::unique_ptr<Session>> sessions;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream tokens(line);
+        std::string name;
+        std::string request;
+        tokens >> name;
+        std::getline(tokens >> std::ws, request);
+        if (name.empty() || request.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        std::unique_ptr<Session>& session = sessions[name];
+        if (!session) {
+            session = CreateSession([this, name, &out](const std::string& text) {
+                std::lock_guard<std::mutex> lock(output_mutex_);
+                std::istringstream lines(text);
+                std::string line;
+                while (std::getline(lines, line)) {
+                    out << name << " " << line << std::endl;
+                }
+                out.flush();
+            });
+        }
+        session->HandleRequest(request);
+        if (!session->protocol.is_running()) {
+            sessions.erase(name);
+        }
+    }
+}
+
+bool Server::Run(const std::string& socket_path) {
+    sockaddr_un address;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path.c_str());
+    unlink(socket_path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) || listen(fd, SOMAXCONN)) {
+        close(fd);
+        return false;
+    }
+    for (;;) {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client >= 0) {
+            std::thread(&Server::Serve, this, client).detach();
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    close(fd);
+    return false;
+}
+
+std::unique_ptr<Server::Session> Server::CreateSession(SinkBuffer::Sink sink) {
+    std::unique_ptr<Session> session(new Session(config_, std::move(sink), &pool_, game_log_));
+    return session;
+}
+
+void Server::Serve(int fd) {
+    {
+        std::unique_ptr<Session> session = CreateSession([fd](const std::string& text) {
+            for (size_t sent = 0; sent < text.size();) {
+                const ssize_t count = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+                if (count <= 0) {
+                    break;
+                }
+                sent += count;
+            }
+        });
+        std::string pending;
+        char buffer[4096];
+        while (session->protocol.is_running()) {
+            const size_t newline = pending.find('\n');
+            if (newline == std::string::npos) {
+                const ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+                if (count <= 0) {
+                    break;
+                }
+                pending.append(buffer, count);
+                continue;
+            }
+            const std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                session->HandleRequest(line);
+            }
+        }
+    }
+    close(fd);
+}
+
+}  // namespace asparagus
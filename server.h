@@ -0,0 +1,57 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_SERVER_H
+#define ASPARAGUS_SERVER_H
+
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "common.h"
+#include "search_pool.h"
+
+namespace asparagus {
+
+class Config;
+class GameLog;
+
+// Hosts many concurrent games in one process. Every session speaks the simple
+// protocol with its own Controller and an Engine whose cache is limited to
+// session_cache_size megabytes. The pattern trie and the Zobrist keys are shared
+// and searches are run on a bounded SearchPool. A search holds a thread of the
+// pool for at most session_time_limit milliseconds, and sessions can neither
+// search without limits nor write files. Sessions log their games to the
+// optional game log.
+class Server final {
+public:
+    explicit Server(const Config& config, GameLog* game_log = nullptr);
+    ~Server();
+
+    // Serves sessions multiplexed over a single stream pair. Every request starts
+    // with a session name which prefixes the responses too. Sessions are created
+    // on first use and closed by "quit".
+    void Run(std::istream& in, std::ostream& out);
+    // Serves one session per connection on a Unix domain socket. Only returns if
+    // the socket cannot be set up.
+    bool Run(const std::string& socket_path);
+
+private:
+    struct Session;
+
+    const Config& config_;
+    GameLog* game_log_;
+    SearchPool pool_;
+    std::mutex output_mutex_;
+
+    std::unique_ptr<Session> CreateSession(std::function<void(const std::string&)> sink);
+    void Serve(int fd);
+
+    DISALLOW_COPY_AND_ASSIGN(Server);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_SERVER_H
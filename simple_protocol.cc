@@ -2,18 +2,28 @@
 
 #include "simple_protocol.h"
 
+#include <chrono>
+#include <fstream>
 #include <iomanip>
+#include <sstream>
 
 #include "board.h"
 #include "config.h"
 #include "controller.h"
+#include "perft.h"
+#include "sparse_board.h"
 
 namespace asparagus {
 
+#ifdef USE_SEARCH_RECORDER
+// About 32 MB of nodes.
+static constexpr uint64_t kDefaultRecordedNodes = 1u << 20u;
+#endif  // USE_SEARCH_RECORDER
+
 static int ReadTokens(std::istream& in, std::vector<std::string>* tokens) {
     std::string token;
     while (int ch = in.get()) {
-        if (ch == '\r' || ch == '\n') {
+        if (ch == EOF || ch == '\r' || ch == '\n') {
             break;
         }
         if (isspace(ch)) {
@@ -31,9 +41,18 @@ static int ReadTokens(std::istream& in, std::vector<std::string>* tokens) {
     return tokens->size();
 }
 
-SimpleProtocol::SimpleProtocol(Config *config, Controller* controller)
-    :   config_(config),
-        controller_(controller) {}
+SimpleProtocol::SimpleProtocol(Config *config, Controller* controller, std::ostream& output,
+                               SearchPool* pool, int max_time)
+    :   Protocol(output),
+        config_(config),
+        controller_(controller),
+        is_server_session_(pool != nullptr),
+        max_time_(max_time),
+        search_thread_(controller, pool) {
+    #ifdef USE_TRACER
+    trace_count_ = 0;
+    #endif  // USE_TRACER
+}
 
 bool SimpleProtocol::HandleRequest(std::istream& request, std::ostream& response) {
     std::vector<std::string> tokens;
@@ -42,12 +61,24 @@ bool SimpleProtocol::HandleRequest(std::istream& request, std::ostream& response
         tokens.erase(tokens.begin());
         if (command == "quit") {
             HandleQuit(response);
-        } else if (command == "start") {
+            return true;
+        } else if (command == "stop") {
+            HandleStop();
+            return false;
+        } else if (search_thread_.is_searching()) {
+            response << "error: engine is thinking";
+            return true;
+        }
+        // The callback of a finished search may still be reading the controller.
+        search_thread_.Wait();
+        if (command == "start") {
             HandleStart(tokens, response);
         } else if (command == "move") {
             HandleMove(tokens, response);
         } else if (command == "go") {
-            HandleGo(response);
+            // The move is sent once the search is done, only errors are answered here.
+            HandleGo(tokens, response);
+            return response.tellp() > 0;
         } else if (command == "set") {
             HandleSet(tokens, response);
         } else if (command == "get") {
@@ -57,16 +88,31 @@ bool SimpleProtocol::HandleRequest(std::istream& request, std::ostream& response
         } else if (command == "print") {
             HandlePrint(response);
         } else if (command == "stats") {
-            HandleStats(response);
+            HandleStats(tokens, response);
+        } else if ((command == "trace" || command == "record") && is_server_session_) {
+            response << "error: " << command << " is not available in server sessions";
+        } else if (command == "trace") {
+            HandleTrace(tokens, response);
+        } else if (command == "record") {
+            HandleRecord(tokens, response);
+        } else if (command == "perft") {
+            HandlePerft(tokens, response);
         } else {
             response << "error: unknown command: " << command;
         }
         return true;
     }
+    if (!request) {
+        search_thread_.Stop();
+        search_thread_.Wait();
+        Quit();
+    }
     return false;
 }
 
 void SimpleProtocol::HandleQuit(std::ostream& response) {
+    search_thread_.Stop();
+    search_thread_.Wait();
     Quit();
     response << "bye";
 }
@@ -76,14 +122,29 @@ void SimpleProtocol::HandleStart(const std::vector<std::string>& args, std::ostr
         response << "error: bad arguments";
         return;
     }
-    const int width = std::stoi(args[0]);
-    const int height = args.size() == 2 ? std::stoi(args[1]) : width;
-    if (width < Board::kMinSize || width > Board::kMaxSize ||
-        height < Board::kMinSize || height > Board::kMaxSize) {
+    if (args.size() == 1 && args[0] == "infinite") {
+        controller_->StartSparse(0, 0);
+        response << "ok";
+        return;
+    }
+    int width;
+    int height;
+    if (!Config::ParseNumber(args[0], &width) ||
+        !Config::ParseNumber(args.size() == 2 ? args[1] : args[0], &height)) {
+        response << "error: bad arguments";
+        return;
+    }
+    if (width < Board::kMinSize || width >= SparseBoard::kMaxCoordinate ||
+        height < Board::kMinSize || height >= SparseBoard::kMaxCoordinate) {
         response << "error: illegal size: " << width << "x" << height;
         return;
     }
-    controller_->Start(width, height);
+    // Boards too large for the dense board are played on a sparse one.
+    if (width > Board::kMaxSize || height > Board::kMaxSize) {
+        controller_->StartSparse(width, height);
+    } else {
+        controller_->Start(width, height);
+    }
     response << "ok";
 }
 
@@ -92,14 +153,30 @@ void SimpleProtocol::HandleMove(const std::vector<std::string>& args, std::ostre
         response << "error: bad arguments";
         return;
     }
-    const int x = std::stoi(args[0]);
-    const int y = std::stoi(args[1]);
-    const Cell move = MakeCell(x, y);
-    if (!controller_->board().IsEmptyCell(move)) {
-        response << "error: illegal move: " << x << " " << y;
+    int x;
+    int y;
+    if (!Config::ParseNumber(args[0], &x) || !Config::ParseNumber(args[1], &y)) {
+        response << "error: bad arguments";
         return;
     }
-    controller_->PlayerMove(move);
+    if (controller_->is_sparse()) {
+        if (controller_->sparse_board().stone(x, y) != kEmpty) {
+            response << "error: illegal move: " << x << " " << y;
+            return;
+        }
+        controller_->PlayerMove(x, y);
+    } else {
+        const Cell move = MakeCell(x, y);
+        if (!controller_->board().IsEmptyCell(move)) {
+            response << "error: illegal move: " << x << " " << y;
+            return;
+        }
+        if (controller_->IsForbiddenMove(move, kPlayer)) {
+            response << "error: forbidden move: " << x << " " << y;
+            return;
+        }
+        controller_->PlayerMove(move);
+    }
     switch (controller_->state()) {
         case Controller::kPlaying:
             response << "ok";
@@ -115,25 +192,73 @@ void SimpleProtocol::HandleMove(const std::vector<std::string>& args, std::ostre
     }
 }
 
-void SimpleProtocol::HandleGo( std::ostream& response) {
-    Cell move = controller_->GetEngineMove();
-    response << GetX(move) << " " << GetY(move);
-    switch (controller_->state()) {
-        case Controller::kWon:
-            response << " engine won";
-            break;
-        case Controller::kDraw:
-            response << " draw";
-            break;
-        default:
-            break;
+void SimpleProtocol::HandleGo(const std::vector<std::string>& args, std::ostream& response) {
+    if (args.size() > 1 || (args.size() == 1 && args[0] != "infinite")) {
+        response << "error: bad arguments";
+        return;
     }
+    if (controller_->state() == Controller::kUnknown) {
+        response << "error: game is not started";
+        return;
+    }
+    SearchControl control;
+    control.is_infinite = args.size() == 1;
+    if (control.is_infinite && is_server_session_) {
+        // It would keep a thread of the shared pool until stopped.
+        response << "error: infinite search is not available in server sessions";
+        return;
+    }
+    control.max_time = max_time_;
+    control.on_iteration = [this](const SearchInfo& info) {
+        std::ostringstream line;
+        line << "info depth " << info.depth << " score " << info.score << " nodes " << info.nodes
+             << " nps " << static_cast<uint64_t>(info.time > 0.0 ? info.nodes / info.time : 0.0)
+             << " time " << static_cast<int>(info.time * 1000.0) << " pv";
+        for (auto move : info.pv) {
+            const SparseBoard::Point point = controller_->GetPoint(move);
+            line << " " << point.x << "," << point.y;
+        }
+        Send(line.str());
+    };
+    search_thread_.Start(control, [this](Cell move) {
+        std::ostringstream line;
+        if (GetX(move)) {
+            const SparseBoard::Point point = controller_->GetPoint(move);
+            line << point.x << " " << point.y;
+        } else {
+            line << "0 0";
+        }
+        switch (controller_->state()) {
+            case Controller::kWon:
+                line << " engine won";
+                break;
+            case Controller::kDraw:
+                line << " draw";
+                break;
+            default:
+                break;
+        }
+        #ifdef USE_TRACER
+        if (!trace_prefix_.empty()) {
+            std::ofstream out(trace_prefix_ + std::to_string(++trace_count_) + ".json");
+            controller_->DumpTrace(out, true);
+        }
+        #endif  // USE_TRACER
+        Send(line.str());
+    });
+}
+
+void SimpleProtocol::HandleStop() {
+    search_thread_.Stop();
 }
 
 void SimpleProtocol::HandleSet(const std::vector<std::string>& args, std::ostream& response) {
-    if (args.size() == 2) {
-        config_->Set(args[0], std::stoi(args[1]));
+    int value;
+    if (args.size() != 2 || !Config::ParseNumber(args[1], &value)) {
+        response << "error: bad arguments";
+        return;
     }
+    config_->Set(args[0], value);
 }
 
 void SimpleProtocol::HandleGet(const std::vector<std::string>& args, std::ostream& response) {
@@ -147,10 +272,17 @@ void SimpleProtocol::HandleBoard(const std::vector<std::string>& args, std::ostr
         response << "error: bad arguments";
         return;
     }
-    const int x = std::stoi(args[0]);
-    const int y = std::stoi(args[1]);
+    int x;
+    int y;
+    if (!Config::ParseNumber(args[0], &x) || !Config::ParseNumber(args[1], &y)) {
+        response << "error: bad arguments";
+        return;
+    }
     const Cell cell = MakeCell(x, y);
-    if (!controller_->board().IsInside(cell)) {
+    const bool is_inside = controller_->is_sparse() ?
+                           controller_->sparse_board().IsInside(x, y) :
+                           controller_->board().IsInside(cell);
+    if (!is_inside) {
         response << "error: invalid cell: " << x << " " << y;
         return;
     }
@@ -168,11 +300,19 @@ void SimpleProtocol::HandleBoard(const std::vector<std::string>& args, std::ostr
         response << "error: unknown value " << args[2];
         return;
     }
-    controller_->SetCell(cell, stone);
+    if (controller_->is_sparse()) {
+        controller_->SetCell(x, y, stone);
+    } else {
+        controller_->SetCell(cell, stone);
+    }
     response << "ok";
 }
 
 void SimpleProtocol::HandlePrint(std::ostream& response) {
+    if (controller_->is_sparse()) {
+        PrintSparse(response);
+        return;
+    }
     const Board& board = controller_->board();
     const int width = board.width();
     const int height = board.height();
@@ -193,9 +333,10 @@ void SimpleProtocol::HandlePrint(std::ostream& response) {
     for (int y = 1; y <= height; y++) {
         response << std::setw(2) << y << " ";
         for (int x = 1; x <= width; x++) {
-            const Stone stone = board.stone(MakeCell(x, y));
+            const Cell cell = MakeCell(x, y);
+            const Stone stone = board.stone(cell);
             if (stone == kEmpty) {
-                response << "+";
+                response << (board.IsForbidden(cell) ? "-" : "+");
             } else if (stone == kEngine) {
                 response << "O";
             } else if (stone == kPlayer) {
@@ -211,10 +352,131 @@ void SimpleProtocol::HandlePrint(std::ostream& response) {
     }
 }
 
-void SimpleProtocol::HandleStats(std::ostream& response) {
+void SimpleProtocol::PrintSparse(std::ostream& response) {
+    // Prints the window around the last stone that the engine would search.
+    Board window;
+    const SparseBoard::Point origin = controller_->sparse_board().GetWindow(1, &window);
+    response << "x " << origin.x << ".." << origin.x + window.width() - 1
+             << " y " << origin.y << ".." << origin.y + window.height() - 1 << std::endl;
+    for (int y = 1; y <= window.height(); y++) {
+        response << std::setw(6) << origin.y + y - 1 << " ";
+        for (int x = 1; x <= window.width(); x++) {
+            const Stone stone = window.stone(MakeCell(x, y));
+            if (stone == kEmpty) {
+                response << "+";
+            } else if (stone == kEngine) {
+                response << "O";
+            } else if (stone == kPlayer) {
+                response << "X";
+            } else {
+                response << "?";
+            }
+            if (x < window.width()) {
+                response << " ";
+            }
+        }
+        response << std::endl;
+    }
+}
+
+void SimpleProtocol::HandleStats(const std::vector<std::string>& args, std::ostream& response) {
 #ifdef COLLECT_STATISTICS
-    controller_->PrintStats(response);
+    if (args.empty()) {
+        controller_->PrintStats(response);
+    } else if (args.size() == 1 && args[0] == "json") {
+        controller_->WriteLatencyJson(response);
+    } else {
+        response << "error: bad arguments";
+    }
 #endif   // COLLECT_STATISTICS
 }
 
+void SimpleProtocol::HandleTrace(const std::vector<std::string>& args, std::ostream& response) {
+#ifdef USE_TRACER
+    if (args.size() == 1) {
+        std::ofstream out(args[0]);
+        if (!out) {
+            response << "error: cannot open file: " << args[0];
+            return;
+        }
+        controller_->DumpTrace(out, true);
+        response << "ok";
+    } else if (args.size() == 2 && args[0] == "per_move") {
+        trace_prefix_ = args[1] == "off" ? std::string() : args[1];
+        trace_count_ = 0;
+        response << "ok";
+    } else {
+        response << "error: bad arguments";
+    }
+#else  // USE_TRACER
+    response << "error: tracing is not supported";
+#endif  // USE_TRACER
+}
+
+void SimpleProtocol::HandleRecord(const std::vector<std::string>& args, std::ostream& response) {
+#ifdef USE_SEARCH_RECORDER
+    if (args.size() == 1 && args[0] == "off") {
+        controller_->CancelRecording();
+        response << "ok";
+        return;
+    }
+    if (args.empty() || args.size() > 3) {
+        response << "error: bad arguments";
+        return;
+    }
+    uint64_t max_nodes = kDefaultRecordedNodes;
+    int max_ply = MoveStack::kMaxPlies;
+    if ((args.size() > 1 && !Config::ParseNumber(args[1], &max_nodes)) ||
+        (args.size() > 2 && !Config::ParseNumber(args[2], &max_ply))) {
+        response << "error: bad arguments";
+        return;
+    }
+    if (!controller_->RecordSearch(args[0], max_nodes, max_ply)) {
+        response << "error: cannot open file: " << args[0];
+        return;
+    }
+    response << "ok";
+#else  // USE_SEARCH_RECORDER
+    response << "error: recording is not supported";
+#endif  // USE_SEARCH_RECORDER
+}
+
+void SimpleProtocol::HandlePerft(const std::vector<std::string>& args, std::ostream& response) {
+    std::vector<std::string> numbers(args);
+    const bool is_checked = !numbers.empty() && numbers.back() == "check";
+    if (is_checked) {
+        numbers.pop_back();
+    }
+    if (numbers.size() < 2 || numbers.size() > 3) {
+        response << "error: bad arguments";
+        return;
+    }
+    int depth;
+    int distance;
+    int threads = config_->threads();
+    if (!Config::ParseNumber(numbers[0], &depth) || !Config::ParseNumber(numbers[1], &distance) ||
+        (numbers.size() == 3 && !Config::ParseNumber(numbers[2], &threads)) ||
+        depth < 0 || depth >= MoveStack::kMaxPlies || distance < 1) {
+        response << "error: bad arguments";
+        return;
+    }
+    if (search_thread_.is_searching()) {
+        response << "error: search in progress";
+        return;
+    }
+    const Board& board = controller_->board();
+    const auto start_time = std::chrono::steady_clock::now();
+    const uint64_t leaves = Perft::Count(board, kEngine, depth, distance, config_->is_exact_five(), false, threads);
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+    response << leaves << " leaves " << static_cast<int64_t>(duration.count() * 1000.0) << " ms "
+             << static_cast<uint64_t>(leaves / std::max(duration.count(), 1e-6)) << " leaves/sec";
+    if (is_checked) {
+        const uint64_t reference = Perft::Count(board, kEngine, depth, distance, config_->is_exact_five(), true,
+                                                threads);
+        if (reference != leaves) {
+            response << std::endl << "error: reference count " << reference;
+        }
+    }
+}
+
 }  // namespace asparagus
@@ -7,31 +7,52 @@
 #include <vector>
 
 #include "protocol.h"
+#include "search_thread.h"
 
 namespace asparagus {
 
 class Config;
 class Controller;
+class SearchPool;
 
 class SimpleProtocol final : public Protocol {
 public:
-    explicit SimpleProtocol(Config* config, Controller* controller);
+    // A pool makes the protocol a session of a server, its searches take at
+    // most max_time milliseconds.
+    SimpleProtocol(Config* config, Controller* controller, std::ostream& output,
+                   SearchPool* pool = nullptr, int max_time = 0);
 
     bool HandleRequest(std::istream& request, std::ostream& response) override;
 
 private:
     Config* config_;
     Controller* controller_;
+    // Sessions of a server share the search pool and are driven by remote
+    // clients: their searches are capped and they cannot write files.
+    bool is_server_session_;
+    int max_time_;
+    #ifdef USE_TRACER
+    std::string trace_prefix_;
+    int trace_count_;
+    #endif  // USE_TRACER
+    SearchThread search_thread_;
 
     void HandleQuit(std::ostream& response);
     void HandleStart(const std::vector<std::string>& args, std::ostream& response);
     void HandleMove(const std::vector<std::string>& args, std::ostream& response);
-    void HandleGo(std::ostream& response);
+    void HandleGo(const std::vector<std::string>& args, std::ostream& response);
+    void HandleStop();
     void HandleSet(const std::vector<std::string>& args, std::ostream& response);
     void HandleGet(const std::vector<std::string>& args, std::ostream& response);
     void HandleBoard(const std::vector<std::string>& args, std::ostream& response);
     void HandlePrint(std::ostream& response);
-    void HandleStats(std::ostream& response);
+    void PrintSparse(std::ostream& response);
+    void HandleStats(const std::vector<std::string>& args, std::ostream& response);
+    void HandleTrace(const std::vector<std::string>& args, std::ostream& response);
+    // record <file> [<max nodes> [<max ply>]] | record off
+    void HandleRecord(const std::vector<std::string>& args, std::ostream& response);
+    // perft <depth> <distance> [<threads>] [check]
+    void HandlePerft(const std::vector<std::string>& args, std::ostream& response);
 
     DISALLOW_COPY_AND_ASSIGN(SimpleProtocol);
 };
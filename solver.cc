@@ -0,0 +1,562 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "solver.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+
+namespace asparagus {
+
+static const char kMagic[8] = { 'A', 'S', 'P', 'S', 'O', 'L', 'V', '1' };
+
+// The finalizer of splitmix64, it spreads the keys over the table and makes
+// the Zobrist keys of the large boards.
+static uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27u)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31u);
+}
+
+// Bounds are packed into the low bits of the data word, the lowest bit marks
+// the entry as used.
+static uint64_t PackBounds(int lower, int upper) {
+    return 1u | static_cast<uint64_t>(lower + 1) << 1u | static_cast<uint64_t>(upper + 1) << 3u;
+}
+
+constexpr int SolverTable::kExactCells;
+
+SolverTable::SolverTable()
+    :   entries_(nullptr),
+        capacity_(0),
+        width_(0),
+        height_(0),
+        is_exact_five_(false) {}
+
+bool SolverTable::Open(const std::string& path) {
+    return file_.Open(path) && Attach();
+}
+
+bool SolverTable::Create(const std::string& path, int width, int height, bool is_exact_five,
+                         uint64_t size) {
+    uint64_t capacity = 1;
+    while (capacity * 2 * sizeof(Entry) <= size) {
+        capacity *= 2;
+    }
+    if (!file_.Create(path, kHeaderSize + capacity * sizeof(Entry))) {
+        return false;
+    }
+    uint8_t* header = file_.mutable_data();
+    if (!memcmp(header, kMagic, sizeof(kMagic))) {
+        return Attach() && width_ == width && height_ == height && is_exact_five_ == is_exact_five;
+    }
+    const uint32_t fields[4] = {
+        static_cast<uint32_t>(width), static_cast<uint32_t>(height), is_exact_five ? 1u : 0u, 0u
+    };
+    memcpy(header + sizeof(kMagic), fields, sizeof(fields));
+    memcpy(header + sizeof(kMagic) + sizeof(fields), &capacity, sizeof(capacity));
+    memcpy(header, kMagic, sizeof(kMagic));
+    return Attach();
+}
+
+bool SolverTable::Attach() {
+    const uint8_t* header = file_.data();
+    if (file_.size() < kHeaderSize || memcmp(header, kMagic, sizeof(kMagic))) {
+        file_.Close();
+        return false;
+    }
+    uint32_t fields[4];
+    memcpy(fields, header + sizeof(kMagic), sizeof(fields));
+    memcpy(&capacity_, header + sizeof(kMagic) + sizeof(fields), sizeof(capacity_));
+    width_ = fields[0];
+    height_ = fields[1];
+    is_exact_five_ = fields[2] != 0;
+    if (!capacity_ || (capacity_ & (capacity_ - 1)) ||
+        kHeaderSize + capacity_ * sizeof(Entry) > file_.size()) {
+        file_.Close();
+        return false;
+    }
+    entries_ = reinterpret_cast<Entry*>(const_cast<uint8_t*>(header) + kHeaderSize);
+    return true;
+}
+
+bool SolverTable::Sync() {
+    return file_.Sync();
+}
+
+bool SolverTable::Matches(const Board& board, bool is_exact_five) const {
+    return board.width() == width_ && board.height() == height_ && !board.black() &&
+           is_exact_five == is_exact_five_;
+}
+
+uint64_t SolverTable::CountUsed() const {
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < capacity_; i++) {
+        count += entries_[i].data_.load(std::memory_order_relaxed) != 0;
+    }
+    return count;
+}
+
+bool SolverTable::Find(uint64_t key, int* lower, int* upper) const {
+    const uint64_t mask = capacity_ - 1;
+    for (uint64_t i = Mix(key) & mask, probe = 0; probe < kMaxProbes; i = (i + 1) & mask, probe++) {
+        const uint64_t data = entries_[i].data_.load(std::memory_order_relaxed);
+        if (!data) {
+            return false;
+        }
+        if ((entries_[i].check_.load(std::memory_order_relaxed) ^ data) == key) {
+            *lower = static_cast<int>(data >> 1u & 3u) - 1;
+            *upper = static_cast<int>(data >> 3u & 3u) - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SolverTable::Store(uint64_t key, int lower, int upper) {
+    if (!file_.mutable_data()) {
+        return;
+    }
+    const uint64_t mask = capacity_ - 1;
+    for (uint64_t i = Mix(key) & mask, probe = 0; probe < kMaxProbes; i = (i + 1) & mask, probe++) {
+        Entry& entry = entries_[i];
+        const uint64_t data = entry.data_.load(std::memory_order_relaxed);
+        const bool is_match = data && (entry.check_.load(std::memory_order_relaxed) ^ data) == key;
+        // A full run of probes gives up its last entry, a lost entry costs
+        // only time.
+        if (data && !is_match && probe + 1 < kMaxProbes) {
+            continue;
+        }
+        if (is_match) {
+            lower = std::max(lower, static_cast<int>(data >> 1u & 3u) - 1);
+            upper = std::min(upper, static_cast<int>(data >> 3u & 3u) - 1);
+        }
+        const uint64_t bounds = PackBounds(lower, upper);
+        entry.check_.store(key ^ bounds, std::memory_order_relaxed);
+        entry.data_.store(bounds, std::memory_order_relaxed);
+        return;
+    }
+}
+
+const SolverTable* SolverTable::Get(const std::string& path) {
+    // Tables are opened once and shared by all engines, they are never closed.
+    static std::mutex mutex;
+    static std::map<std::string, const SolverTable*> tables;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tables.find(path);
+    if (it != tables.end()) {
+        return it->second;
+    }
+    SolverTable* table = new SolverTable();
+    if (!table->Open(path)) {
+        delete table;
+        return nullptr;
+    }
+    tables[path] = table;
+    return table;
+}
+
+// The board of a search thread. Cells are numbered row by row from zero, and
+// the keys of every symmetric image of the position are kept up to date.
+class Solver::Position final {
+public:
+    static constexpr int kMaxCells = kMaxSize * kMaxSize;
+
+    Position(int width, int height, bool is_exact_five);
+
+    int empty() const { return empty_; }
+    const std::vector<int>& order() const { return order_; }
+    Stone stone(int index) const { return cells_[index]; }
+    Cell GetCell(int index) const { return MakeCell(index % width_ + 1, index / width_ + 1); }
+
+    void Load(const Board& board);
+    void Set(int index, Stone stone);
+    // The smallest key of the symmetric images. Up to SolverTable::kExactCells
+    // the digits of the base 3 key are 1 for the side to move and 2 for the
+    // other side, beyond them the sums are Zobrist keys instead.
+    uint64_t GetKey(Stone to_move) const;
+    bool IsFive(int index, Stone stone) const;
+    // A side can still win while some line of five has no stone of the other.
+    bool CanWin(Stone stone) const;
+    // Every line of five through a dead cell holds stones of both sides, a
+    // stone there changes nothing.
+    bool IsDead(int index) const;
+
+private:
+    int width_;
+    int height_;
+    int symmetries_;
+    bool is_exact_five_;
+    bool is_exact_key_;
+    int empty_;
+    Stone cells_[kMaxCells];
+    uint64_t weights_[8][kMaxCells];
+    uint64_t sums_[2][8];
+    std::vector<int> windows_;
+    // The first cells of the lines through each cell.
+    std::vector<int> cell_windows_[kMaxCells];
+    std::vector<int> order_;
+
+    bool IsOpen(int window, Stone stone) const;
+    int CountSimilar(int x, int y, int dx, int dy, Stone stone) const;
+};
+
+constexpr int Solver::Position::kMaxCells;
+
+Solver::Position::Position(int width, int height, bool is_exact_five)
+    :   width_(width),
+        height_(height),
+        symmetries_(width == height ? 8 : 4),
+        is_exact_five_(is_exact_five),
+        is_exact_key_(width * height <= SolverTable::kExactCells),
+        empty_(width * height) {
+    memset(cells_, 0, sizeof(cells_));
+    memset(sums_, 0, sizeof(sums_));
+    // Powers of 3 wrap around beyond the exact cells, the Zobrist keys there are
+    // the splitmix64 sequence, as a table has to find them again in later runs.
+    uint64_t keys[kMaxCells];
+    for (int i = 0; i < kMaxCells; i++) {
+        if (is_exact_key_) {
+            keys[i] = i > 0 ? keys[i - 1] * 3u : 1u;
+        } else {
+            keys[i] = Mix((static_cast<uint64_t>(i) + 1u) * 0x9e3779b97f4a7c15ull);
+        }
+    }
+    for (int s = 0; s < symmetries_; s++) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int tx = (s & 4) ? y : x;
+                int ty = (s & 4) ? x : y;
+                tx = (s & 1) ? width - 1 - tx : tx;
+                ty = (s & 2) ? height - 1 - ty : ty;
+                weights_[s][y * width + x] = keys[ty * width + tx];
+            }
+        }
+    }
+
+    static const int kDirections[4][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, -1 } };
+    for (auto& direction : kDirections) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const int last_x = x + 4 * direction[0];
+                const int last_y = y + 4 * direction[1];
+                if (last_x >= width || last_y < 0 || last_y >= height) {
+                    continue;
+                }
+                for (int i = 0; i < 5; i++) {
+                    const int index = (y + i * direction[1]) * width + x + i * direction[0];
+                    cell_windows_[index].push_back(windows_.size() - i);
+                    windows_.push_back(index);
+                }
+            }
+        }
+    }
+
+    // The centre first, alpha-beta cuts sooner on the strong moves.
+    for (int i = 0; i < width * height; i++) {
+        order_.push_back(i);
+    }
+    auto distance = [width, height](int index) {
+        return std::abs(2 * (index % width) - width + 1) + std::abs(2 * (index / width) - height + 1);
+    };
+    std::stable_sort(order_.begin(), order_.end(), [&distance](int a, int b) {
+        return distance(a) < distance(b);
+    });
+}
+
+void Solver::Position::Load(const Board& board) {
+    for (int y = 0; y < height_; y++) {
+        for (int x = 0; x < width_; x++) {
+            Set(y * width_ + x, kEmpty);
+            const Stone stone = board.stone(MakeCell(x + 1, y + 1));
+            if (IsStone(stone)) {
+                Set(y * width_ + x, stone);
+            }
+        }
+    }
+}
+
+void Solver::Position::Set(int index, Stone stone) {
+    const Stone previous = cells_[index];
+    if (IsStone(previous)) {
+        uint64_t* sums = sums_[previous == kPlayer];
+        for (int s = 0; s < symmetries_; s++) {
+            sums[s] = is_exact_key_ ? sums[s] - weights_[s][index] : sums[s] ^ weights_[s][index];
+        }
+        empty_ += 1;
+    }
+    if (IsStone(stone)) {
+        uint64_t* sums = sums_[stone == kPlayer];
+        for (int s = 0; s < symmetries_; s++) {
+            sums[s] = is_exact_key_ ? sums[s] + weights_[s][index] : sums[s] ^ weights_[s][index];
+        }
+        empty_ -= 1;
+    }
+    cells_[index] = stone;
+}
+
+uint64_t Solver::Position::GetKey(Stone to_move) const {
+    const uint64_t* own = sums_[to_move == kPlayer];
+    const uint64_t* other = sums_[to_move != kPlayer];
+    // The stones of the other side are told apart by mixing their keys once more.
+    auto image_key = [this, own, other](int s) {
+        return is_exact_key_ ? own[s] + 2u * other[s] : own[s] ^ Mix(other[s]);
+    };
+    uint64_t key = image_key(0);
+    for (int s = 1; s < symmetries_; s++) {
+        key = std::min(key, image_key(s));
+    }
+    return key;
+}
+
+bool Solver::Position::IsFive(int index, Stone stone) const {
+    static const int kDirections[4][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, -1 } };
+    const int x = index % width_;
+    const int y = index / width_;
+    for (auto& direction : kDirections) {
+        const int dx = direction[0];
+        const int dy = direction[1];
+        const int count = CountSimilar(x, y, dx, dy, stone) + CountSimilar(x, y, -dx, -dy, stone);
+        if (count == 4 || (!is_exact_five_ && count > 4)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Solver::Position::CanWin(Stone stone) const {
+    for (size_t i = 0; i < windows_.size(); i += 5) {
+        if (IsOpen(i, stone)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Solver::Position::IsDead(int index) const {
+    for (int window : cell_windows_[index]) {
+        if (IsOpen(window, kEngine) || IsOpen(window, kPlayer)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Solver::Position::IsOpen(int window, Stone stone) const {
+    for (int i = window; i < window + 5; i++) {
+        if (IsStone(cells_[windows_[i]]) && cells_[windows_[i]] != stone) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int Solver::Position::CountSimilar(int x, int y, int dx, int dy, Stone stone) const {
+    int count = 0;
+    for (x += dx, y += dy; x >= 0 && x < width_ && y >= 0 && y < height_; x += dx, y += dy) {
+        if (cells_[y * width_ + x] != stone) {
+            break;
+        }
+        count += 1;
+    }
+    return count;
+}
+
+constexpr int Solver::kMaxSize;
+
+Solver::Solver(SolverTable* table, int threads)
+    :   table_(table),
+        threads_(std::max(threads, 1)),
+        stop_(false),
+        nodes_(0) {}
+
+Solver::Value Solver::Solve(const Board& board, Stone to_move) {
+    const Stone other = to_move == kEngine ? kPlayer : kEngine;
+    Position root(table_->width(), table_->height(), table_->is_exact_five());
+    root.Load(board);
+    stop_.store(false, std::memory_order_relaxed);
+    nodes_.store(0, std::memory_order_relaxed);
+
+    const uint64_t key = root.GetKey(to_move);
+    int lower = kLoss;
+    int upper = kWin;
+    if (table_->Find(key, &lower, &upper) && lower == upper) {
+        return static_cast<Value>(lower);
+    }
+
+    // Symmetric moves lead to the same position, only one of them is searched.
+    std::vector<int> moves;
+    std::set<uint64_t> children;
+    for (int index : root.order()) {
+        if (IsStone(root.stone(index))) {
+            continue;
+        }
+        if (root.IsFive(index, to_move)) {
+            table_->Store(key, kWin, kWin);
+            return kWin;
+        }
+        root.Set(index, to_move);
+        if (children.insert(root.GetKey(other)).second) {
+            moves.push_back(index);
+        }
+        root.Set(index, kEmpty);
+    }
+    if (moves.empty()) {
+        table_->Store(key, kDraw, kDraw);
+        return kDraw;
+    }
+
+    std::atomic<int> next(0);
+    std::atomic<int> best(kLoss - 1);
+    auto work = [&]() {
+        Position position = root;
+        uint64_t nodes = 0;
+        for (int i = next.fetch_add(1); i < static_cast<int>(moves.size()); i = next.fetch_add(1)) {
+            // Moves that cannot beat the best value so far only need a bound.
+            const int alpha = std::max(best.load(std::memory_order_relaxed), static_cast<int>(kLoss));
+            position.Set(moves[i], to_move);
+            const int value = -NegaMax(&position, other, -kWin, -alpha, &nodes);
+            position.Set(moves[i], kEmpty);
+            if (stop_.load(std::memory_order_relaxed)) {
+                break;
+            }
+            int current = best.load(std::memory_order_relaxed);
+            while (value > current && !best.compare_exchange_weak(current, value)) {}
+            if (value == kWin) {
+                stop_.store(true, std::memory_order_relaxed);
+            }
+        }
+        nodes_.fetch_add(nodes, std::memory_order_relaxed);
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads_; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const int value = best.load();
+    table_->Store(key, value, value);
+    return static_cast<Value>(value);
+}
+
+int Solver::NegaMax(Position* position, Stone to_move, int alpha, int beta, uint64_t* nodes) {
+    *nodes += 1;
+    if (!position->empty()) {
+        return kDraw;
+    }
+    const Stone other = to_move == kEngine ? kPlayer : kEngine;
+    const uint64_t key = position->GetKey(to_move);
+    int lower = kLoss;
+    int upper = kWin;
+    table_->Find(key, &lower, &upper);
+    if (!position->CanWin(to_move)) {
+        upper = std::min(upper, static_cast<int>(kDraw));
+    }
+    if (!position->CanWin(other)) {
+        lower = std::max(lower, static_cast<int>(kDraw));
+    }
+    if (lower >= beta || lower == upper) {
+        return lower;
+    }
+    if (upper <= alpha) {
+        return upper;
+    }
+    alpha = std::max(alpha, lower);
+    beta = std::min(beta, upper);
+
+    // A five ends the game, a five of the other side must be blocked.
+    int blocks[Position::kMaxCells];
+    int block_count = 0;
+    for (int index : position->order()) {
+        if (IsStone(position->stone(index))) {
+            continue;
+        }
+        if (position->IsFive(index, to_move)) {
+            table_->Store(key, kWin, kWin);
+            return kWin;
+        }
+        if (position->IsFive(index, other)) {
+            blocks[block_count++] = index;
+        }
+    }
+    const int* moves = block_count ? blocks : position->order().data();
+    const int move_count = block_count ? block_count : static_cast<int>(position->order().size());
+
+    const int original_alpha = alpha;
+    int best = kLoss - 1;
+    bool is_dead_searched = false;
+    for (int i = 0; i < move_count; i++) {
+        const int index = moves[i];
+        if (IsStone(position->stone(index))) {
+            continue;
+        }
+        // Moves on dead cells are all alike, one of them is enough.
+        if (position->IsDead(index)) {
+            if (is_dead_searched) {
+                continue;
+            }
+            is_dead_searched = true;
+        }
+        position->Set(index, to_move);
+        const int value = -NegaMax(position, other, -beta, -alpha, nodes);
+        position->Set(index, kEmpty);
+        if (stop_.load(std::memory_order_relaxed)) {
+            return kDraw;
+        }
+        best = std::max(best, value);
+        alpha = std::max(alpha, value);
+        if (alpha >= beta) {
+            break;
+        }
+    }
+    if (best <= original_alpha) {
+        table_->Store(key, lower, best);
+    } else if (best >= beta) {
+        table_->Store(key, best, upper);
+    } else {
+        table_->Store(key, best, best);
+    }
+    return best;
+}
+
+Cell Solver::GetMove(const SolverTable& table, const Board& board, Stone to_move) {
+    const Stone other = to_move == kEngine ? kPlayer : kEngine;
+    Position position(table.width(), table.height(), table.is_exact_five());
+    position.Load(board);
+    for (int index : position.order()) {
+        if (!IsStone(position.stone(index)) && position.IsFive(index, to_move)) {
+            return position.GetCell(index);
+        }
+    }
+    int lower;
+    int upper;
+    if (!table.Find(position.GetKey(to_move), &lower, &upper) || lower == kLoss) {
+        return MakeCell(0, 0);
+    }
+    for (int index : position.order()) {
+        if (IsStone(position.stone(index))) {
+            continue;
+        }
+        position.Set(index, to_move);
+        int child_lower;
+        int child_upper;
+        const bool is_proved = table.Find(position.GetKey(other), &child_lower, &child_upper) &&
+                               child_upper <= -lower;
+        position.Set(index, kEmpty);
+        if (is_proved) {
+            return position.GetCell(index);
+        }
+    }
+    return MakeCell(0, 0);
+}
+
+}  // namespace asparagus
@@ -0,0 +1,111 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_SOLVER_H
+#define ASPARAGUS_SOLVER_H
+
+#include <atomic>
+#include <string>
+
+#include "common.h"
+#include "mapped_file.h"
+
+namespace asparagus {
+
+class Board;
+
+// Solved positions of a small board in a memory-mapped file, so that a solve
+// can be resumed and the engine can play from the results. Entries hold bounds
+// of the game value for the side to move and are keyed by the position reduced
+// by the symmetries of the board. Threads may share a table without locks,
+// a torn entry fails its check and reads as missing.
+class SolverTable final {
+public:
+    // Keys encode every position exactly up to this many cells, larger boards
+    // use 64 bit Zobrist keys, so a hit there is right with high probability.
+    static constexpr int kExactCells = 40;
+
+    SolverTable();
+
+    constexpr int width() const { return width_; }
+    constexpr int height() const { return height_; }
+    constexpr bool is_exact_five() const { return is_exact_five_; }
+    constexpr uint64_t capacity() const { return capacity_; }
+
+    // Opens a table for reading.
+    bool Open(const std::string& path);
+    // Opens a table for writing, a missing file is created with room for
+    // about size bytes of entries. An existing table keeps its size.
+    bool Create(const std::string& path, int width, int height, bool is_exact_five, uint64_t size);
+    bool Sync();
+    // Tells whether the table solves the games played on the board.
+    bool Matches(const Board& board, bool is_exact_five) const;
+    uint64_t CountUsed() const;
+
+    bool Find(uint64_t key, int* lower, int* upper) const;
+    // Narrows the bounds stored for the key. Only writable tables store.
+    void Store(uint64_t key, int lower, int upper);
+
+    // Returns the shared read-only table of the file, nullptr if the file cannot
+    // be opened.
+    static const SolverTable* Get(const std::string& path);
+
+private:
+    static constexpr int kHeaderSize = 64;
+    static constexpr int kMaxProbes = 8;
+
+    struct Entry {
+        std::atomic<uint64_t> check_;
+        std::atomic<uint64_t> data_;
+    };
+
+    MappedFile file_;
+    Entry* entries_;
+    uint64_t capacity_;
+    int width_;
+    int height_;
+    bool is_exact_five_;
+
+    bool Attach();
+
+    DISALLOW_COPY_AND_ASSIGN(SolverTable);
+};
+
+// Exhaustive search of small boards for the game value with perfect play:
+// a win, a draw or a loss for the side to move. It searches every empty cell
+// but for these cuts: alpha-beta on the three values and the bounds of the
+// table, the forced blocks of fives, the draw bounds of sides that have no room
+// left for a five, a single move of the dead cells that no five can pass
+// through any more, and a single root move of those leading to symmetric
+// positions.
+class Solver final {
+public:
+    enum Value { kLoss = -1, kDraw = 0, kWin = 1 };
+
+    static constexpr int kMaxSize = 9;
+
+    Solver(SolverTable* table, int threads);
+
+    uint64_t nodes() const { return nodes_.load(std::memory_order_relaxed); }
+
+    // Splits the root moves between the threads.
+    Value Solve(const Board& board, Stone to_move);
+    // A move that keeps the value proved by the table, MakeCell(0, 0) if the
+    // table does not prove one or the position is lost anyway.
+    static Cell GetMove(const SolverTable& table, const Board& board, Stone to_move);
+
+private:
+    class Position;
+
+    SolverTable* table_;
+    int threads_;
+    std::atomic<bool> stop_;
+    std::atomic<uint64_t> nodes_;
+
+    int NegaMax(Position* position, Stone to_move, int alpha, int beta, uint64_t* nodes);
+
+    DISALLOW_COPY_AND_ASSIGN(Solver);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_SOLVER_H
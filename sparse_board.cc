@@ -0,0 +1,189 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "sparse_board.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "board.h"
+
+namespace asparagus {
+
+// The finalizer of splitmix64, it spreads every input bit over the whole key.
+static uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27u)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31u);
+}
+
+static uint64_t PackPoint(int32_t x, int32_t y) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32u | static_cast<uint32_t>(y);
+}
+
+constexpr int32_t SparseBoard::kMaxCoordinate;
+
+std::size_t SparseBoard::KeyHash::operator ()(uint64_t key) const {
+    return static_cast<std::size_t>(Mix(key));
+}
+
+SparseBoard::SparseBoard()
+    :   width_(0),
+        height_(0),
+        hash_(0) {}
+
+bool SparseBoard::IsInside(int32_t x, int32_t y) const {
+    if (width_) {
+        return x > 0 && x <= width_ && y > 0 && y <= height_;
+    }
+    return x > -kMaxCoordinate && x < kMaxCoordinate && y > -kMaxCoordinate && y < kMaxCoordinate;
+}
+
+Stone SparseBoard::stone(int32_t x, int32_t y) const {
+    if (!IsInside(x, y)) {
+        return kBoundary;
+    }
+    const auto it = chunks_.find(GetChunkKey(x, y));
+    if (it == chunks_.end()) {
+        return kEmpty;
+    }
+    return it->second.stones[(y & kChunkMask) << kChunkBits | (x & kChunkMask)];
+}
+
+bool SparseBoard::IsTerminalMove(int32_t x, int32_t y, Stone stone, bool is_exact_five) const {
+    static const int kDirections[4][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, -1 } };
+    for (auto& direction : kDirections) {
+        const int dx = direction[0];
+        const int dy = direction[1];
+        const int count = CountSimilar(x, y, dx, dy, stone) + CountSimilar(x, y, -dx, -dy, stone);
+        if ((is_exact_five && count == 4) || (!is_exact_five && count >= 4)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SparseBoard::Initialize(int width, int height) {
+    width_ = width;
+    height_ = height;
+    Clear();
+}
+
+void SparseBoard::Clear() {
+    hash_ = 0;
+    stones_.clear();
+    chunks_.clear();
+}
+
+void SparseBoard::Set(int32_t x, int32_t y, Stone stone) {
+    const Stone previous = this->stone(x, y);
+    if (previous == stone || previous == kBoundary) {
+        return;
+    }
+    if (previous) {
+        hash_ ^= GetStoneKey(x, y, previous);
+    }
+    if (stone) {
+        hash_ ^= GetStoneKey(x, y, stone);
+    }
+
+    const uint64_t key = GetChunkKey(x, y);
+    Chunk& chunk = chunks_[key];
+    chunk.stones[(y & kChunkMask) << kChunkBits | (x & kChunkMask)] = stone;
+    if (!previous) {
+        chunk.count += 1;
+        stones_.push_back({ x, y });
+    } else if (!stone) {
+        chunk.count -= 1;
+        stones_.erase(std::find_if(stones_.begin(), stones_.end(), [x, y](const Point& point) {
+            return point.x == x && point.y == y;
+        }));
+    }
+    if (!chunk.count) {
+        chunks_.erase(key);
+    }
+}
+
+void SparseBoard::GetPossibleMoves(int dist, std::vector<Point>* moves) const {
+    static const int kDirections[8][2] = {
+        { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 },
+    };
+    std::unordered_set<uint64_t, KeyHash> seen;
+    for (auto& base : stones_) {
+        for (auto& direction : kDirections) {
+            int32_t x = base.x;
+            int32_t y = base.y;
+            for (int i = 0; i < dist; i++) {
+                x += direction[0];
+                y += direction[1];
+                const Stone value = stone(x, y);
+                if (value == kBoundary) {
+                    break;
+                }
+                if (value == kEmpty && seen.insert(PackPoint(x, y)).second) {
+                    moves->push_back({ x, y });
+                }
+            }
+        }
+    }
+}
+
+SparseBoard::Point SparseBoard::GetWindow(int margin, Board* board) const {
+    Point first = { 0, 0 };
+    if (width_) {
+        first = { (width_ + 1) / 2, (height_ + 1) / 2 };
+    }
+    Point last = first;
+    if (!stones_.empty()) {
+        first = last = stones_.front();
+        for (auto& point : stones_) {
+            first = { std::min(first.x, point.x), std::min(first.y, point.y) };
+            last = { std::max(last.x, point.x), std::max(last.y, point.y) };
+        }
+    }
+    first = { first.x - margin, first.y - margin };
+    last = { last.x + margin, last.y + margin };
+
+    // A wide spread of stones is cut around the last one, the fight is there.
+    const Point centre = stones_.empty() ? first : stones_.back();
+    if (last.x - first.x + 1 > Board::kMaxSize) {
+        first.x = std::max(first.x, std::min(centre.x - Board::kMaxSize / 2,
+                                             last.x - Board::kMaxSize + 1));
+        last.x = first.x + Board::kMaxSize - 1;
+    }
+    if (last.y - first.y + 1 > Board::kMaxSize) {
+        first.y = std::max(first.y, std::min(centre.y - Board::kMaxSize / 2,
+                                             last.y - Board::kMaxSize + 1));
+        last.y = first.y + Board::kMaxSize - 1;
+    }
+    if (width_) {
+        first = { std::max(first.x, 1), std::max(first.y, 1) };
+        last = { std::min(last.x, width_), std::min(last.y, height_) };
+    }
+
+    board->Initialize(last.x - first.x + 1, last.y - first.y + 1);
+    for (auto& point : stones_) {
+        if (point.x >= first.x && point.x <= last.x && point.y >= first.y && point.y <= last.y) {
+            board->Set(MakeCell(point.x - first.x + 1, point.y - first.y + 1),
+                       stone(point.x, point.y));
+        }
+    }
+    return first;
+}
+
+uint64_t SparseBoard::GetChunkKey(int32_t x, int32_t y) {
+    return PackPoint(x >> kChunkBits, y >> kChunkBits);
+}
+
+uint64_t SparseBoard::GetStoneKey(int32_t x, int32_t y, Stone stone) {
+    return Mix(Mix(PackPoint(x, y)) + stone);
+}
+
+int SparseBoard::CountSimilar(int32_t x, int32_t y, int dx, int dy, Stone stone) const {
+    int count = 0;
+    for (x += dx, y += dy; this->stone(x, y) == stone; x += dx, y += dy) {
+        count += 1;
+    }
+    return count;
+}
+
+}  // namespace asparagus
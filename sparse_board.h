@@ -0,0 +1,88 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_SPARSE_BOARD_H
+#define ASPARAGUS_SPARSE_BOARD_H
+
+#include "common.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace asparagus {
+
+class Board;
+
+// A board for freestyle games beyond Board::kMaxSize, bounded or infinite.
+// Only the regions around the stones are stored, in fixed-size chunks that are
+// allocated as the stones spread. Hashing, win detection and move generation
+// cost time in proportion to the stones, not to the area of the board. The
+// search runs on a dense window of the board, see GetWindow.
+class SparseBoard final {
+public:
+    // Keeps coordinates far enough from the int32 limits to step around freely.
+    static constexpr int32_t kMaxCoordinate = 1 << 30;
+
+    struct Point {
+        int32_t x;
+        int32_t y;
+    };
+
+    SparseBoard();
+
+    // Zero width and height mean an infinite board.
+    constexpr int width() const { return width_; }
+    constexpr int height() const { return height_; }
+    constexpr uint64_t hash() const { return hash_; }
+    const std::vector<Point>& stones() const { return stones_; }
+
+    bool IsInside(int32_t x, int32_t y) const;
+    // kBoundary outside of a bounded board.
+    Stone stone(int32_t x, int32_t y) const;
+    bool IsTerminalMove(int32_t x, int32_t y, Stone stone, bool is_exact_five) const;
+
+    // Bounded boards use the coordinates of Board, 1 to width and 1 to height.
+    void Initialize(int width, int height);
+    void Clear();
+    void Set(int32_t x, int32_t y, Stone stone);
+    // Empty cells within dist steps of a stone in the eight directions.
+    void GetPossibleMoves(int dist, std::vector<Point>* moves) const;
+    // Copies the stones around the last one into a dense board of at most
+    // Board::kMaxSize cells per side, with at least margin cells around the
+    // stones where the board allows. The window grows by the margin beyond the
+    // bounding box of the stones, so lines running off its edges see the stones
+    // of the real board within the margin. Returns the coordinates of the
+    // window cell (1, 1).
+    Point GetWindow(int margin, Board* board) const;
+
+private:
+    static constexpr int kChunkBits = 4;
+    static constexpr int kChunkSize = 1 << kChunkBits;
+    static constexpr int kChunkMask = kChunkSize - 1;
+
+    struct Chunk {
+        int count = 0;
+        Stone stones[kChunkSize * kChunkSize] = {};
+    };
+
+    struct KeyHash {
+        std::size_t operator ()(uint64_t key) const;
+    };
+
+    int width_;
+    int height_;
+    uint64_t hash_;
+    // Occupied cells in the order they were set.
+    std::vector<Point> stones_;
+    std::unordered_map<uint64_t, Chunk, KeyHash> chunks_;
+
+    static uint64_t GetChunkKey(int32_t x, int32_t y);
+    static uint64_t GetStoneKey(int32_t x, int32_t y, Stone stone);
+    int CountSimilar(int32_t x, int32_t y, int dx, int dy, Stone stone) const;
+
+    DISALLOW_COPY_AND_ASSIGN(SparseBoard);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_SPARSE_BOARD_H
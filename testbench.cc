@@ -6,6 +6,7 @@
 #include "config.h"
 #include "engine.h"
 #include "controller.h"
+#include "game_log.h"
 
 using namespace asparagus;
 
@@ -13,13 +14,21 @@ constexpr int size = 19;
 constexpr int rounds = 5;
 
 int main(int argc, char** argv) {
-    InitializeRandoms();
     Config config;
-    config.Load(argc, argv);
+    std::string bad_argument;
+    if (!config.Load(argc, argv, &bad_argument)) {
+        std::cerr << "error: invalid argument: " << bad_argument << std::endl;
+        return 1;
+    }
+    InitializeRandoms(static_cast<uint32_t>(config.seed()));
     Engine engine_1(config);
     Engine engine_2(config);
+    GameLog game_log;
     Controller controller_1(config, &engine_1);
     Controller controller_2(config, &engine_2);
+    if (!config.game_log_file().empty() && game_log.Open(config.game_log_file())) {
+        controller_1.set_game_log(&game_log);
+    }
     controller_1.Start(size, size);
     controller_2.Start(size, size);
     Cell move = MakeCell(0, 0);
@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "tracer.h"
+
+#include <chrono>
+
+namespace asparagus {
+
+static int GetThreadId() {
+    static std::atomic<int> next_id(1);
+    thread_local int id = next_id.fetch_add(1);
+    return id;
+}
+
+Tracer::Tracer()
+    :   enabled_(false),
+        head_(0),
+        events_(nullptr) {}
+
+Tracer::~Tracer() {
+    delete [] events_;
+}
+
+void Tracer::Enable(bool enabled) {
+    if (enabled && !events_) {
+        events_ = new Event[kCapacity];
+        Clear();
+    }
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::Clear() {
+    if (!events_) {
+        return;
+    }
+    for (uint64_t i = 0; i < kCapacity; i++) {
+        events_[i].sequence_.store(0, std::memory_order_relaxed);
+    }
+    head_.store(0, std::memory_order_release);
+}
+
+void Tracer::Record(const char* name, int64_t start, int64_t end, int arg) {
+    const uint64_t index = head_.fetch_add(1u, std::memory_order_relaxed);
+    Event& event = events_[index % kCapacity];
+    event.sequence_.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name_ = name;
+    event.start_ = start;
+    event.end_ = end;
+    event.arg_ = arg;
+    event.thread_ = GetThreadId();
+    event.sequence_.store(index + 1u, std::memory_order_release);
+}
+
+void Tracer::Dump(std::ostream& out) const {
+    const uint64_t head = events_ ? head_.load(std::memory_order_acquire) : 0;
+    const uint64_t first = head > kCapacity ? head - kCapacity : 0;
+    out << "{\"traceEvents\":[";
+    bool is_first = true;
+    for (uint64_t index = first; index < head; index++) {
+        const Event& event = events_[index % kCapacity];
+        if (event.sequence_.load(std::memory_order_acquire) != index + 1u) {
+            continue;
+        }
+        const char* name = event.name_;
+        const int64_t start = event.start_;
+        const int64_t end = event.end_;
+        const int arg = event.arg_;
+        const int thread = event.thread_;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.sequence_.load(std::memory_order_relaxed) != index + 1u) {
+            continue;
+        }
+        if (!is_first) {
+            out << ",";
+        }
+        is_first = false;
+        out << std::endl << "{\"name\":\"" << name << "\",\"cat\":\"search\",\"ph\":\"X\""
+            << ",\"ts\":" << start / 1000 << "." << start % 1000 / 100
+            << ",\"dur\":" << (end - start) / 1000 << "." << (end - start) % 1000 / 100
+            << ",\"pid\":1,\"tid\":" << thread
+            << ",\"args\":{\"arg\":" << arg << "}}";
+    }
+    out << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+int64_t Tracer::Now() {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+}  // namespace asparagus
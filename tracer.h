@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_TRACER_H
+#define ASPARAGUS_TRACER_H
+
+#include <atomic>
+#include <ostream>
+
+#include "common.h"
+
+namespace asparagus {
+
+// Records timed spans into a fixed size ring buffer and writes them out in the
+// Chrome trace-event format (chrome://tracing, Perfetto). Recording is lock free,
+// the oldest spans are overwritten when the buffer is full. A disabled tracer
+// costs a single relaxed load per span, the buffer is only allocated when the
+// tracer is enabled for the first time.
+class Tracer final {
+public:
+    static constexpr uint64_t kCapacity = 1u << 16u;
+
+    class Span final {
+    public:
+        Span(Tracer* tracer, const char* name, int arg = 0)
+            :   tracer_(tracer && tracer->is_enabled() ? tracer : nullptr),
+                name_(name),
+                arg_(arg),
+                start_(tracer_ ? Now() : 0) {}
+
+        ~Span() {
+            if (tracer_) {
+                tracer_->Record(name_, start_, Now(), arg_);
+            }
+        }
+
+    private:
+        Tracer* tracer_;
+        const char* name_;
+        int arg_;
+        int64_t start_;
+
+        DISALLOW_COPY_AND_ASSIGN(Span);
+    };
+
+    Tracer();
+    ~Tracer();
+
+    bool is_enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void Enable(bool enabled);
+    void Clear();
+    void Record(const char* name, int64_t start, int64_t end, int arg);
+    void Dump(std::ostream& out) const;
+
+    static int64_t Now();
+
+private:
+    struct Event {
+        std::atomic<uint64_t> sequence_;
+        const char* name_;
+        int64_t start_;
+        int64_t end_;
+        int arg_;
+        int thread_;
+    };
+
+    std::atomic<bool> enabled_;
+    std::atomic<uint64_t> head_;
+    Event* events_;
+
+    DISALLOW_COPY_AND_ASSIGN(Tracer);
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_TRACER_H
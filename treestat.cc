@@ -0,0 +1,182 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+// Summarises a search tree recorded with the "record" command of the simple
+// protocol.
+//
+//   treestat <tree file> [<worst nodes>]
+//     Prints the move ordering quality per remaining depth: how the cache
+//     answered the nodes, how many failed high and the rank of the move that
+//     did. Then lists the nodes where the cutoff came latest, with the moves
+//     leading to them, 10 by default.
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "search_recorder.h"
+
+using namespace asparagus;
+
+// Upper ends of the rank buckets of the cutoff moves, 1 is the first move.
+static const int kRankLimits[] = { 1, 2, 3, 6, 12, 1 << 16 };
+static constexpr int kRankBuckets = sizeof(kRankLimits) / sizeof(kRankLimits[0]);
+
+struct DepthStats {
+    uint64_t nodes = 0;
+    uint64_t cache[4] = {};
+    uint64_t searched = 0;
+    uint64_t fail_high = 0;
+    // Cutoffs by the first move when the cache supplied the move and when not.
+    uint64_t cached_first = 0;
+    uint64_t cached_fail_high = 0;
+    uint64_t uncached_first = 0;
+    uint64_t uncached_fail_high = 0;
+    uint64_t rank_sum = 0;
+    uint64_t ranks[kRankBuckets] = {};
+    uint64_t moves_searched = 0;
+};
+
+static std::string FormatMove(Cell cell) {
+    return std::to_string(GetX(cell)) + "," + std::to_string(GetY(cell));
+}
+
+static double Percent(uint64_t count, uint64_t total) {
+    return total ? 100.0 * static_cast<double>(count) / static_cast<double>(total) : 0.0;
+}
+
+static void PrintDepths(const std::vector<DepthStats>& depths) {
+    printf("depth    nodes  miss shal bnd  cut  | fail high  first  cached  uncached  avg rank  moves |");
+    int from = 1;
+    for (int limit : kRankLimits) {
+        if (limit == from) {
+            printf(" %6d", limit);
+        } else if (limit < 1 << 16) {
+            printf(" %3d-%-2d", from, limit);
+        } else {
+            printf(" %5d+", from);
+        }
+        from = limit + 1;
+    }
+    printf("\n");
+    for (int depth = static_cast<int>(depths.size()) - 1; depth > 0; depth--) {
+        const DepthStats& stats = depths[depth];
+        if (!stats.nodes) {
+            continue;
+        }
+        printf("%5d %8llu %4.0f%% %3.0f%% %3.0f%% %3.0f%% | %8.1f%% %5.1f%% %6.1f%% %8.1f%% %9.2f %6.1f |",
+               depth, static_cast<unsigned long long>(stats.nodes),
+               Percent(stats.cache[SearchRecorder::kCacheMiss], stats.nodes),
+               Percent(stats.cache[SearchRecorder::kCacheShallow], stats.nodes),
+               Percent(stats.cache[SearchRecorder::kCacheBound], stats.nodes),
+               Percent(stats.cache[SearchRecorder::kCacheCutoff], stats.nodes),
+               Percent(stats.fail_high, stats.searched),
+               Percent(stats.cached_first + stats.uncached_first, stats.fail_high),
+               Percent(stats.cached_first, stats.cached_fail_high),
+               Percent(stats.uncached_first, stats.uncached_fail_high),
+               stats.fail_high ? static_cast<double>(stats.rank_sum) / static_cast<double>(stats.fail_high) : 0.0,
+               stats.searched ? static_cast<double>(stats.moves_searched) / static_cast<double>(stats.searched) : 0.0);
+        for (uint64_t count : stats.ranks) {
+            printf(" %5.1f%%", Percent(count, stats.fail_high));
+        }
+        printf("\n");
+    }
+}
+
+static void PrintWorst(const std::vector<SearchRecorder::Node>& nodes, size_t count) {
+    // The path to every node follows from the plies of the preorder.
+    std::vector<uint32_t> parents(nodes.size());
+    std::vector<uint32_t> stack;
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        while (!stack.empty() && nodes[stack.back()].ply >= nodes[i].ply) {
+            stack.pop_back();
+        }
+        parents[i] = stack.empty() ? i : stack.back();
+        stack.push_back(i);
+    }
+    std::vector<uint32_t> worst;
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].cutoff > 0) {
+            worst.push_back(i);
+        }
+    }
+    count = std::min(count, worst.size());
+    std::partial_sort(worst.begin(), worst.begin() + count, worst.end(), [&nodes](uint32_t a, uint32_t b) {
+        return nodes[a].cutoff > nodes[b].cutoff ||
+               (nodes[a].cutoff == nodes[b].cutoff && nodes[a].depth > nodes[b].depth);
+    });
+    if (!count) {
+        return;
+    }
+    printf("\nlatest cutoffs:\n");
+    for (size_t i = 0; i < count; i++) {
+        const SearchRecorder::Node& node = nodes[worst[i]];
+        std::vector<Cell> path;
+        for (uint32_t index = worst[i]; nodes[index].ply > 0 && parents[index] != index; index = parents[index]) {
+            path.push_back(nodes[index].move);
+        }
+        printf(" rank %d of %d depth %d ply %d hash %016llx cutoff %s window [%d, %d] path",
+               node.cutoff + 1, node.moves, node.depth, node.ply, static_cast<unsigned long long>(node.hash),
+               FormatMove(node.best_move).c_str(), node.alpha, node.beta);
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            printf(" %s", FormatMove(*it).c_str());
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: treestat <tree file> [<worst nodes>]" << std::endl;
+        return 1;
+    }
+    std::vector<SearchRecorder::Node> nodes;
+    bool is_truncated;
+    if (!SearchRecorder::Load(argv[1], &nodes, &is_truncated)) {
+        std::cerr << "error: cannot read tree: " << argv[1] << std::endl;
+        return 1;
+    }
+    const size_t worst_count = argc > 2 ? std::stoul(argv[2]) : 10;
+
+    std::vector<DepthStats> depths;
+    uint64_t unfinished = 0;
+    for (const auto& node : nodes) {
+        if (!(node.flags & SearchRecorder::kLeft)) {
+            unfinished += 1;
+            continue;
+        }
+        if (node.depth >= depths.size()) {
+            depths.resize(node.depth + 1);
+        }
+        DepthStats& stats = depths[node.depth];
+        stats.nodes += 1;
+        stats.cache[node.cache & 3u] += 1;
+        if (node.cache == SearchRecorder::kCacheCutoff) {
+            continue;
+        }
+        stats.searched += 1;
+        stats.moves_searched += node.moves;
+        if (node.cutoff < 0) {
+            continue;
+        }
+        const bool is_cached = node.cache != SearchRecorder::kCacheMiss;
+        stats.fail_high += 1;
+        (is_cached ? stats.cached_fail_high : stats.uncached_fail_high) += 1;
+        if (!node.cutoff) {
+            (is_cached ? stats.cached_first : stats.uncached_first) += 1;
+        }
+        stats.rank_sum += node.cutoff + 1;
+        int bucket = 0;
+        while (node.cutoff + 1 > kRankLimits[bucket]) {
+            bucket += 1;
+        }
+        stats.ranks[bucket] += 1;
+    }
+
+    printf("%zu nodes%s, %llu unfinished\n\n", nodes.size(), is_truncated ? " (truncated)" : "",
+           static_cast<unsigned long long>(unfinished));
+    PrintDepths(depths);
+    PrintWorst(nodes, worst_count);
+    return 0;
+}
@@ -0,0 +1,727 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+// Tunes the pattern values of the static evaluation.
+//
+//   tuner selfplay <games> <data file> [--key=value ...]
+//     Plays games between two engines from random openings, by default at
+//     max_depth 2 without quiescence search, and writes every
+//     position with the result for the side to move:
+//       <result> <size> <moves>
+//     the result is 1, 0.5 or 0, the moves use the batch text format. The
+//     games are logged too with --game_log=<file>.
+//   tuner games <game log> <data file>
+//     Writes the positions before the searched moves of the logged games in
+//     the data format of selfplay. Games with stones set out of turn or taken
+//     back are skipped.
+//   tuner tune <data file> <weights file> [<epochs>] [--weights=<initial>] [--threads=<n>]
+//     Fits the values to the results with Texel style logistic regression and
+//     writes a weights file that the engine loads with --weights=<file>.
+//   tuner network <data file> <network file> [<epochs>]
+//     Trains the small network on the results with stochastic gradient descent
+//     and writes the quantized network that the engine evaluates with
+//     --network=<file> instead of the patterns.
+//
+// Patterns and their O/X mirrors share a single value of opposite sign, values
+// are tuned in the log domain so that they keep their signs and scale freely.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "board.h"
+#include "config.h"
+#include "controller.h"
+#include "engine.h"
+#include "evaluator.h"
+#include "game_log.h"
+#include "network.h"
+#include "patterns.h"
+#include "position_stream.h"
+#include "randoms.h"
+#include "weights.h"
+
+using namespace asparagus;
+
+constexpr int kBoardSize = 15;
+constexpr int kOpeningMoves = 4;
+constexpr int kOpeningRadius = 3;
+constexpr int kDefaultEpochs = 200;
+constexpr double kLearningRate = 0.02;
+constexpr int kDefaultNetworkEpochs = 20;
+constexpr double kNetworkLearningRate = 0.01;
+// Evaluations of the network per unit of the logit of the result, about the
+// scale of the pattern values.
+constexpr float kNetworkScale = 1000.0f;
+// The int16 accumulator holds the input weights of every stone of a full
+// board within this limit, the int8 weights stay within kWeightLimit.
+constexpr float kInputLimit = 1.0f;
+constexpr float kWeightLimit = 127.0f / Network::kWeightScale;
+
+static int GetThreadCount(const Config& config) {
+    if (config.threads() > 0) {
+        return config.threads();
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+static void RunThreads(int threads, const std::function<void(int)>& work) {
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+static std::string PlayGame(const Config& config, uint64_t cache_size, int game, GameLog* game_log) {
+    std::mt19937 random(game);
+    Engine engines[2] = { {config, cache_size}, {config, cache_size} };
+    Controller controllers[2] = { {config, &engines[0]}, {config, &engines[1]} };
+    for (auto& controller : controllers) {
+        controller.Start(kBoardSize, kBoardSize);
+    }
+
+    // The first side plays the O stones of the logged game.
+    GameRecord record;
+    record.width = kBoardSize;
+    record.height = kBoardSize;
+    record.is_exact_five = config.is_exact_five();
+    record.is_renju = config.is_renju();
+    std::vector<Cell> moves;
+    std::vector<int> sides;
+    int side = 0;
+    const int center = (kBoardSize + 1) / 2;
+    std::uniform_int_distribution<int> offset(-kOpeningRadius, kOpeningRadius);
+    while (static_cast<int>(moves.size()) < kOpeningMoves) {
+        const Cell move = MakeCell(center + offset(random), center + offset(random));
+        if (controllers[0].board().stone(move) != kEmpty) {
+            continue;
+        }
+        controllers[side].SetCell(move, kEngine);
+        controllers[1 - side].SetCell(move, kPlayer);
+        moves.push_back(move);
+        record.moves.push_back({ move, side ? kPlayer : kEngine, false, 0, 0, 0, 0 });
+        side = 1 - side;
+    }
+
+    int winner = -1;
+    const size_t first = moves.size();
+    while (static_cast<int>(moves.size()) < kBoardSize * kBoardSize) {
+        const Cell move = controllers[side].GetEngineMove();
+        if (!GetX(move)) {
+            break;
+        }
+        sides.push_back(side);
+        moves.push_back(move);
+        GameMove logged = controllers[side].game().moves.back();
+        logged.stone = side ? kPlayer : kEngine;
+        record.moves.push_back(logged);
+        if (controllers[side].state() == Controller::kWon) {
+            winner = side;
+            break;
+        }
+        controllers[1 - side].PlayerMove(move);
+        side = 1 - side;
+    }
+
+    record.result = winner < 0 ? GameRecord::kDraw :
+                    winner == 0 ? GameRecord::kEngineWon : GameRecord::kPlayerWon;
+    game_log->Write(record);
+
+    // Every position before a searched move, seen by the side to move.
+    std::ostringstream out;
+    for (size_t i = first; i < moves.size(); i++) {
+        const int mover = sides[i - first];
+        out << (winner < 0 ? "0.5" : winner == mover ? "1" : "0") << " " << kBoardSize;
+        for (size_t j = 0; j < i; j++) {
+            out << " " << GetX(moves[j]) << "," << GetY(moves[j]);
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+static bool SelfPlay(const Config& config, int games, const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    GameLog game_log;
+    if (!config.game_log_file().empty() && !game_log.Open(config.game_log_file())) {
+        std::cerr << "error: cannot open game log: " << config.game_log_file() << std::endl;
+        return false;
+    }
+    const int threads = std::min(games, GetThreadCount(config));
+    const uint64_t cache_size = config.cache_size() / (2u * threads);
+    std::vector<std::string> results(games);
+    RunThreads(threads, [&](int thread) {
+        for (int game = thread; game < games; game += threads) {
+            results[game] = PlayGame(config, cache_size, game, &game_log);
+            std::cerr << "game " << game + 1 << "/" << games << " done" << std::endl;
+        }
+    });
+    for (auto& result : results) {
+        out << result;
+    }
+    return static_cast<bool>(out);
+}
+
+static bool ConvertGames(const std::string& log_path, const std::string& path) {
+    GameLogReader reader;
+    if (!reader.Open(log_path)) {
+        std::cerr << "error: cannot read game log: " << log_path << std::endl;
+        return false;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "error: cannot write file: " << path << std::endl;
+        return false;
+    }
+    GameRecord game;
+    std::ostringstream size;
+    int converted = 0;
+    int skipped = 0;
+    while (reader.Next(&game)) {
+        bool is_alternating = true;
+        for (size_t i = 1; i < game.moves.size(); i++) {
+            is_alternating &= game.moves[i].stone == (game.moves[i - 1].stone ^ kForbidden);
+        }
+        if (game.moves.empty() || game.moves[0].stone == kEmpty || !is_alternating) {
+            skipped += 1;
+            continue;
+        }
+        size.str(std::string());
+        size << game.width;
+        if (game.height != game.width) {
+            size << "x" << game.height;
+        }
+        for (size_t i = 0; i < game.moves.size(); i++) {
+            if (!game.moves[i].is_searched) {
+                continue;
+            }
+            const bool is_engine = game.moves[i].stone == kEngine;
+            out << (game.result == GameRecord::kDraw || game.result == GameRecord::kUnfinished ? "0.5" :
+                    (game.result == GameRecord::kEngineWon) == is_engine ? "1" : "0")
+                << " " << size.str();
+            for (size_t j = 0; j < i; j++) {
+                out << " " << GetX(game.moves[j].cell) << "," << GetY(game.moves[j].cell);
+            }
+            out << "\n";
+        }
+        converted += 1;
+    }
+    std::cerr << "converted " << converted << " games, skipped " << skipped << std::endl;
+    return static_cast<bool>(out);
+}
+
+class Tuner final {
+public:
+    Tuner(const Config& config, Weights* weights)
+        :   weights_(weights),
+            threads_(GetThreadCount(config)),
+            count_(0),
+            scale_(1.0) {}
+
+    bool Load(const std::string& path);
+    void Fit(int epochs);
+
+private:
+    // Patterns sharing a value, sign tells the sign of the value of the member.
+    struct Group {
+        std::vector<std::pair<int, float>> members;
+        double parameter;
+    };
+
+    Weights* weights_;
+    int threads_;
+    size_t count_;
+    std::vector<float> results_;
+    std::vector<Group> groups_;
+    std::vector<int> pattern_groups_;
+    std::vector<float> features_;
+    double scale_;
+
+    void BuildGroups(std::map<std::string, int>* indices);
+    double GetError(const std::vector<double>& values, double scale) const;
+    double GetGradient(const std::vector<double>& values, std::vector<double>* gradient) const;
+    void FitScale(const std::vector<double>& values);
+    std::vector<double> GetValues() const;
+
+    DISALLOW_COPY_AND_ASSIGN(Tuner);
+};
+
+bool Tuner::Load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::vector<uint8_t> records;
+    std::vector<uint8_t> record;
+    Board board;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        float result;
+        if (!(fields >> result)) {
+            continue;
+        }
+        std::string position;
+        std::getline(fields, position);
+        if (!BatchAnalyzer::ParsePosition(position, &board)) {
+            continue;
+        }
+        PositionStream::Encode(board, kEngine, &record);
+        records.insert(records.end(), record.begin(), record.end());
+        results_.push_back(result);
+    }
+
+    std::map<std::string, int> indices;
+    BuildGroups(&indices);
+    Patterns patterns;
+    weights_->Build(&patterns);
+    std::vector<int16_t> counts;
+    const auto start_time = std::chrono::steady_clock::now();
+    count_ = Evaluator::GetFeaturesBatch(patterns, records.data(), records.size(), threads_, &counts);
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+    std::cerr << "positions: " << count_ << ", features extracted in " << duration.count() << " s"
+              << std::endl;
+
+    // Folds the pattern counts into signed group counts.
+    const size_t width = patterns.size();
+    features_.assign(count_ * groups_.size(), 0.0f);
+    for (size_t i = 0; i < count_; i++) {
+        for (size_t group = 0; group < groups_.size(); group++) {
+            float feature = 0.0f;
+            for (auto& member : groups_[group].members) {
+                feature += member.second * counts[i * width + member.first];
+            }
+            features_[i * groups_.size() + group] = feature;
+        }
+    }
+    return count_ > 0;
+}
+
+void Tuner::BuildGroups(std::map<std::string, int>* indices) {
+    const auto& weights = weights_->weights();
+    for (auto& weight : weights) {
+        if (indices->find(weight.pattern) == indices->end()) {
+            const int index = static_cast<int>(indices->size());
+            (*indices)[weight.pattern] = index;
+            pattern_groups_.push_back(-1);
+        }
+    }
+    for (auto& weight : weights) {
+        const int index = indices->at(weight.pattern);
+        if (pattern_groups_[index] >= 0) {
+            continue;
+        }
+        Group group;
+        const float sign = weight.value < 0.0f ? -1.0f : 1.0f;
+        group.members.emplace_back(index, sign);
+        group.parameter = std::log(std::max(std::fabs(weight.value), 1e-3f));
+        pattern_groups_[index] = static_cast<int>(groups_.size());
+
+        std::string mirror = weight.pattern;
+        for (auto& ch : mirror) {
+            ch = ch == 'O' ? 'X' : ch == 'X' ? 'O' : ch;
+        }
+        auto it = indices->find(mirror);
+        if (it != indices->end() && pattern_groups_[it->second] < 0) {
+            group.members.emplace_back(it->second, -sign);
+            pattern_groups_[it->second] = static_cast<int>(groups_.size());
+        }
+        groups_.push_back(group);
+    }
+}
+
+std::vector<double> Tuner::GetValues() const {
+    std::vector<double> values;
+    for (auto& group : groups_) {
+        values.push_back(std::exp(group.parameter));
+    }
+    return values;
+}
+
+double Tuner::GetError(const std::vector<double>& values, double scale) const {
+    std::vector<double> errors(threads_, 0.0);
+    const size_t width = groups_.size();
+    RunThreads(threads_, [&](int thread) {
+        double error = 0.0;
+        for (size_t i = thread; i < count_; i += threads_) {
+            double eval = 0.0;
+            for (size_t group = 0; group < width; group++) {
+                eval += values[group] * features_[i * width + group];
+            }
+            const double sigmoid = 1.0 / (1.0 + std::exp(-scale * eval));
+            error += (results_[i] - sigmoid) * (results_[i] - sigmoid);
+        }
+        errors[thread] = error;
+    });
+    double error = 0.0;
+    for (auto part : errors) {
+        error += part;
+    }
+    return error / count_;
+}
+
+double Tuner::GetGradient(const std::vector<double>& values, std::vector<double>* gradient) const {
+    const size_t width = groups_.size();
+    std::vector<std::vector<double>> gradients(threads_, std::vector<double>(width, 0.0));
+    std::vector<double> errors(threads_, 0.0);
+    RunThreads(threads_, [&](int thread) {
+        std::vector<double>& partial = gradients[thread];
+        double error = 0.0;
+        for (size_t i = thread; i < count_; i += threads_) {
+            const float* features = &features_[i * width];
+            double eval = 0.0;
+            for (size_t group = 0; group < width; group++) {
+                eval += values[group] * features[group];
+            }
+            const double sigmoid = 1.0 / (1.0 + std::exp(-scale_ * eval));
+            const double difference = sigmoid - results_[i];
+            error += difference * difference;
+            const double derivative = 2.0 * difference * sigmoid * (1.0 - sigmoid) * scale_;
+            for (size_t group = 0; group < width; group++) {
+                partial[group] += derivative * features[group];
+            }
+        }
+        errors[thread] = error;
+    });
+    // Chain rule of the log domain parameters.
+    gradient->assign(width, 0.0);
+    double error = 0.0;
+    for (int thread = 0; thread < threads_; thread++) {
+        for (size_t group = 0; group < width; group++) {
+            (*gradient)[group] += gradients[thread][group] * values[group] / count_;
+        }
+        error += errors[thread];
+    }
+    return error / count_;
+}
+
+void Tuner::FitScale(const std::vector<double>& values) {
+    // Golden section search of the sigmoid scale on a log scale.
+    const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+    double low = -12.0;
+    double high = 0.0;
+    for (int i = 0; i < 60; i++) {
+        const double left = high - ratio * (high - low);
+        const double right = low + ratio * (high - low);
+        if (GetError(values, std::pow(10.0, left)) < GetError(values, std::pow(10.0, right))) {
+            high = right;
+        } else {
+            low = left;
+        }
+    }
+    scale_ = std::pow(10.0, (low + high) / 2.0);
+}
+
+void Tuner::Fit(int epochs) {
+    const auto start_time = std::chrono::steady_clock::now();
+    FitScale(GetValues());
+    std::cerr << "scale: " << scale_ << ", error: " << GetError(GetValues(), scale_) << std::endl;
+
+    // Adam on the log domain parameters.
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    std::vector<double> moments(groups_.size(), 0.0);
+    std::vector<double> variances(groups_.size(), 0.0);
+    std::vector<double> gradient;
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        const double error = GetGradient(GetValues(), &gradient);
+        for (size_t group = 0; group < groups_.size(); group++) {
+            moments[group] = beta1 * moments[group] + (1.0 - beta1) * gradient[group];
+            variances[group] = beta2 * variances[group] + (1.0 - beta2) * gradient[group] * gradient[group];
+            const double moment = moments[group] / (1.0 - std::pow(beta1, epoch));
+            const double variance = variances[group] / (1.0 - std::pow(beta2, epoch));
+            groups_[group].parameter -= kLearningRate * moment / (std::sqrt(variance) + 1e-12);
+        }
+        if (epoch % 10 == 0 || epoch == epochs) {
+            std::cerr << "epoch " << epoch << ", error: " << error << std::endl;
+        }
+    }
+
+    std::map<std::string, int> indices;
+    for (auto& weight : weights_->weights()) {
+        if (indices.find(weight.pattern) == indices.end()) {
+            const int index = static_cast<int>(indices.size());
+            indices[weight.pattern] = index;
+        }
+    }
+    for (auto& weight : weights_->weights()) {
+        const int index = indices.at(weight.pattern);
+        const Group& group = groups_[pattern_groups_[index]];
+        for (auto& member : group.members) {
+            if (member.first == index) {
+                weight.value = static_cast<float>(member.second * std::exp(group.parameter));
+            }
+        }
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+    std::cerr << "tuned in " << duration.count() << " s" << std::endl;
+}
+
+static double GetLoss(double sigmoid, double result) {
+    return -(result * std::log(std::max(sigmoid, 1e-12)) + (1.0 - result) * std::log(std::max(1.0 - sigmoid, 1e-12)));
+}
+
+// Fits the float parameters of a network to the results of the positions by
+// minimizing the logistic loss, one position at a time.
+class NetworkTrainer final {
+public:
+    NetworkTrainer() : random_(1) {}
+
+    const Network::Parameters& parameters() const { return parameters_; }
+
+    bool Load(const std::string& path);
+    void Fit(int epochs);
+    // The loss of the quantized network.
+    double GetError(const Network& network) const;
+
+private:
+    static constexpr int kHidden = Network::kHidden;
+    static constexpr int kHidden2 = Network::kHidden2;
+
+    Network::Parameters parameters_;
+    std::mt19937 random_;
+    std::vector<std::vector<int>> inputs_;
+    std::vector<float> results_;
+
+    double Train(size_t index, double rate);
+};
+
+bool NetworkTrainer::Load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    Board board;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        float result;
+        if (!(fields >> result)) {
+            continue;
+        }
+        std::string position;
+        std::getline(fields, position);
+        if (!BatchAnalyzer::ParsePosition(position, &board)) {
+            continue;
+        }
+        std::vector<int> inputs;
+        for (int y = 1; y <= board.height(); y++) {
+            for (int x = 1; x <= board.width(); x++) {
+                const Cell cell = MakeCell(x, y);
+                if (IsStone(board.stone(cell))) {
+                    inputs.push_back(Network::GetInput(cell, board.stone(cell)));
+                }
+            }
+        }
+        inputs_.push_back(std::move(inputs));
+        results_.push_back(result);
+    }
+    std::cerr << "positions: " << inputs_.size() << std::endl;
+
+    // Biases keep the first layer in the linear part of its activation.
+    std::uniform_real_distribution<float> small(-0.05f, 0.05f);
+    std::uniform_real_distribution<float> hidden(-0.2f, 0.2f);
+    for (auto& weight : parameters_.input_weights) {
+        weight = small(random_);
+    }
+    for (auto& bias : parameters_.input_biases) {
+        bias = 0.5f;
+    }
+    for (auto& weight : parameters_.hidden_weights) {
+        weight = hidden(random_);
+    }
+    for (auto& bias : parameters_.hidden_biases) {
+        bias = 0.5f;
+    }
+    for (auto& weight : parameters_.output_weights) {
+        weight = hidden(random_);
+    }
+    parameters_.output_scale = kNetworkScale;
+    return !inputs_.empty();
+}
+
+void NetworkTrainer::Fit(int epochs) {
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector<size_t> order(inputs_.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        std::shuffle(order.begin(), order.end(), random_);
+        const double rate = kNetworkLearningRate / std::sqrt(static_cast<double>(epoch));
+        double error = 0.0;
+        for (size_t index : order) {
+            error += Train(index, rate);
+        }
+        std::cerr << "epoch " << epoch << ", loss: " << error / order.size() << std::endl;
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+    std::cerr << "trained in " << duration.count() << " s" << std::endl;
+}
+
+double NetworkTrainer::Train(size_t index, double rate) {
+    Network::Parameters& p = parameters_;
+    const std::vector<int>& inputs = inputs_[index];
+    float first[kHidden];
+    float second[kHidden2];
+    for (int i = 0; i < kHidden; i++) {
+        first[i] = p.input_biases[i];
+    }
+    for (int input : inputs) {
+        const float* weights = &p.input_weights[static_cast<size_t>(input) * kHidden];
+        for (int i = 0; i < kHidden; i++) {
+            first[i] += weights[i];
+        }
+    }
+    float first_activations[kHidden];
+    for (int i = 0; i < kHidden; i++) {
+        first_activations[i] = std::max(0.0f, std::min(1.0f, first[i]));
+    }
+    float output = p.output_bias;
+    for (int i = 0; i < kHidden2; i++) {
+        float sum = p.hidden_biases[i];
+        for (int j = 0; j < kHidden; j++) {
+            sum += p.hidden_weights[i * kHidden + j] * first_activations[j];
+        }
+        second[i] = sum;
+        output += p.output_weights[i] * std::max(0.0f, std::min(1.0f, sum));
+    }
+
+    const double sigmoid = 1.0 / (1.0 + std::exp(-static_cast<double>(output)));
+    const double result = results_[index];
+    const float gradient = static_cast<float>(rate * (sigmoid - result));
+    float first_gradients[kHidden] = {};
+    for (int i = 0; i < kHidden2; i++) {
+        const bool is_linear = second[i] > 0.0f && second[i] < 1.0f;
+        const float second_gradient = is_linear ? gradient * p.output_weights[i] : 0.0f;
+        p.output_weights[i] -= gradient * std::max(0.0f, std::min(1.0f, second[i]));
+        p.output_weights[i] = std::max(-kWeightLimit, std::min(kWeightLimit, p.output_weights[i]));
+        if (!is_linear) {
+            continue;
+        }
+        float* weights = &p.hidden_weights[i * kHidden];
+        for (int j = 0; j < kHidden; j++) {
+            first_gradients[j] += second_gradient * weights[j];
+            weights[j] = std::max(-kWeightLimit, std::min(kWeightLimit,
+                                                          weights[j] - second_gradient * first_activations[j]));
+        }
+        p.hidden_biases[i] -= second_gradient;
+    }
+    p.output_bias -= gradient;
+    for (int i = 0; i < kHidden; i++) {
+        if (first[i] <= 0.0f || first[i] >= 1.0f) {
+            first_gradients[i] = 0.0f;
+        }
+        p.input_biases[i] = std::max(-kInputLimit, std::min(kInputLimit, p.input_biases[i] - first_gradients[i]));
+    }
+    for (int input : inputs) {
+        float* weights = &p.input_weights[static_cast<size_t>(input) * kHidden];
+        for (int i = 0; i < kHidden; i++) {
+            weights[i] = std::max(-kInputLimit, std::min(kInputLimit, weights[i] - first_gradients[i]));
+        }
+    }
+    return GetLoss(sigmoid, result);
+}
+
+double NetworkTrainer::GetError(const Network& network) const {
+    NetworkAccumulator accumulator(&network);
+    Board board;
+    board.Initialize(Board::kMaxSize, Board::kMaxSize);
+    board.Attach(&accumulator);
+    double error = 0.0;
+    for (size_t i = 0; i < inputs_.size(); i++) {
+        board.Clear();
+        for (int input : inputs_[i]) {
+            board.Set(static_cast<Cell>(input / 2), input % 2 ? kPlayer : kEngine);
+        }
+        const double logit = network.Evaluate(accumulator) / kNetworkScale;
+        error += GetLoss(1.0 / (1.0 + std::exp(-logit)), results_[i]);
+    }
+    board.Attach(nullptr);
+    return error / inputs_.size();
+}
+
+int main(int argc, char** argv) {
+    // Self-play favours many fast games over deep searches, the command line
+    // overrides these defaults.
+    Config config;
+    config.Set("max_depth", 2);
+    config.Set("quiescence_depth", 0);
+    std::string bad_argument;
+    if (!config.Load(argc, argv, &bad_argument)) {
+        std::cerr << "error: invalid argument: " << bad_argument << std::endl;
+        return 1;
+    }
+    InitializeRandoms(static_cast<uint32_t>(config.seed()));
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]).compare(0, 2, "--") != 0) {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.size() == 3 && args[0] == "selfplay") {
+        if (!SelfPlay(config, std::stoi(args[1]), args[2])) {
+            std::cerr << "error: cannot write file: " << args[2] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (args.size() == 3 && args[0] == "games") {
+        return ConvertGames(args[1], args[2]) ? 0 : 1;
+    }
+    if ((args.size() == 3 || args.size() == 4) && args[0] == "tune") {
+        Weights weights;
+        if (!config.weights_file().empty() && !weights.Load(config.weights_file())) {
+            std::cerr << "error: cannot load weights: " << config.weights_file() << std::endl;
+            return 1;
+        }
+        Tuner tuner(config, &weights);
+        if (!tuner.Load(args[1])) {
+            std::cerr << "error: no positions in: " << args[1] << std::endl;
+            return 1;
+        }
+        tuner.Fit(args.size() == 4 ? std::stoi(args[3]) : kDefaultEpochs);
+        if (!weights.Save(args[2])) {
+            std::cerr << "error: cannot write file: " << args[2] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if ((args.size() == 3 || args.size() == 4) && args[0] == "network") {
+        NetworkTrainer trainer;
+        if (!trainer.Load(args[1])) {
+            std::cerr << "error: no positions in: " << args[1] << std::endl;
+            return 1;
+        }
+        trainer.Fit(args.size() == 4 ? std::stoi(args[3]) : kDefaultNetworkEpochs);
+        Network network;
+        network.Quantize(trainer.parameters());
+        std::cerr << "quantized loss: " << trainer.GetError(network) << std::endl;
+        if (!network.Save(args[2])) {
+            std::cerr << "error: cannot write file: " << args[2] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    std::cerr << "usage: tuner selfplay <games> <data file> [--key=value ...]" << std::endl
+              << "       tuner games <game log> <data file>" << std::endl
+              << "       tuner tune <data file> <weights file> [<epochs>] [--key=value ...]" << std::endl
+              << "       tuner network <data file> <network file> [<epochs>]" << std::endl;
+    return 1;
+}
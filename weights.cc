@@ -0,0 +1,131 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#include "weights.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace asparagus {
+
+Weights::Weights() {
+    for (const Pattern* pattern = kPatterns; pattern->pattern_; pattern++) {
+        weights_.push_back({pattern->pattern_, pattern->value_});
+    }
+}
+
+bool Weights::Load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::vector<Weight> weights;
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream fields(line);
+        Weight weight;
+        if (!(fields >> weight.pattern)) {
+            continue;
+        }
+        if (!(fields >> weight.value) ||
+            weight.pattern.find_first_not_of("+OX") != std::string::npos) {
+            return false;
+        }
+        weights.push_back(weight);
+    }
+    weights_.swap(weights);
+    return true;
+}
+
+bool Weights::Save(const std::string& path) const {
+    std::ofstream out(path);
+    out << "# pattern value" << std::endl;
+    out << std::setprecision(std::numeric_limits<float>::max_digits10);
+    for (auto& weight : weights_) {
+        out << weight.pattern << " " << weight.value << std::endl;
+    }
+    return static_cast<bool>(out);
+}
+
+void Weights::Build(Patterns* patterns) const {
+    for (auto& weight : weights_) {
+        const float value = std::max(-static_cast<float>(kMaxPatternValue),
+                                     std::min(static_cast<float>(kMaxPatternValue), std::round(weight.value)));
+        patterns->AddPattern(weight.pattern.c_str(), static_cast<Score>(value));
+    }
+}
+
+const Patterns* Weights::GetPatterns(const std::string& path) {
+    // Tries are immutable, every weights file is loaded once and shared by all
+    // engines. Tries are never freed.
+    static std::mutex mutex;
+    static std::map<std::string, const Patterns*> patterns;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = patterns.find(path);
+    if (it != patterns.end()) {
+        return it->second;
+    }
+    Weights weights;
+    if (!path.empty() && !weights.Load(path)) {
+        return nullptr;
+    }
+    Patterns* trie = new Patterns();
+    weights.Build(trie);
+    patterns[path] = trie;
+    return trie;
+}
+
+constexpr float kValue0     = 0.0f;
+constexpr float kValue2     = 1e1f;
+constexpr float kValue2Open = 2e1f;
+constexpr float kValue3     = 1e2f;
+constexpr float kValue3Open = 2e2f;
+constexpr float kValue4     = 2e2f;
+constexpr float kValue4Open = 1e5f;
+
+const Weights::Pattern Weights::kPatterns[] = {
+    { "OO+++", kValue2 }, { "XX+++", -kValue2 },
+    { "O+O++", kValue2 }, { "X+X++", -kValue2 },
+    { "O++O+", kValue2 }, { "X++X+", -kValue2 },
+    { "O+++O", kValue2 }, { "X+++X", -kValue2 },
+    { "++O+O", kValue2 }, { "++X+X", -kValue2 },
+    { "+++OO", kValue2 }, { "+++XX", -kValue2 },
+
+    { "+OO++", kValue2Open }, { "+XX++", -kValue2Open },
+    { "+O+O+", kValue2Open }, { "+X+X+", -kValue2Open },
+    { "+O++O+", kValue2Open }, { "+X++X+", -kValue2Open },
+    { "++OO+", kValue2Open }, { "++XX+", -kValue2Open },
+
+    { "OOO++", kValue3 }, { "XXX++", -kValue3 },
+    { "OO+O+", kValue3 }, { "XX+X+", -kValue3 },
+    { "OO++O", kValue3 }, { "XX++X", -kValue3 },
+    { "O+OO+", kValue3 }, { "X+XX+", -kValue3 },
+    { "O+O+O", kValue3 }, { "X+X+X", -kValue3 },
+    { "O++OO", kValue3 }, { "X++XX", -kValue3 },
+    { "+OO+O", kValue3 }, { "+XX+X", -kValue3 },
+    { "+O+OO", kValue3 }, { "+X+XX", -kValue3 },
+    { "++OOO", kValue3 }, { "++XXX", -kValue3 },
+
+    { "+OOO+", kValue3Open }, { "+XXX+", -kValue3Open },
+
+    { "OOOO+", kValue4 }, { "XXXX+", -kValue4 },
+    { "OOO+O", kValue4 }, { "XXX+X", -kValue4 },
+    { "OO+OO", kValue4 }, { "XX+XX", -kValue4 },
+    { "O+OOO", kValue4 }, { "X+XXX", -kValue4 },
+    { "+OOOO", kValue4 }, { "+XXXX", -kValue4 },
+
+    { "+OOOO+", kValue4Open }, { "+XXXX+", -kValue4Open },
+
+    { nullptr, kValue0 }
+};
+
+}  // namespace asparagus
@@ -0,0 +1,55 @@
+// Copyright (c) 2020 Gyorgy Abonyi. All Rights Reserved.
+
+#ifndef ASPARAGUS_WEIGHTS_H
+#define ASPARAGUS_WEIGHTS_H
+
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "patterns.h"
+#include "score.h"
+
+namespace asparagus {
+
+// The patterns of the static evaluation and their values. The built in table
+// can be replaced by a text file with one "<pattern> <value>" pair per line,
+// '#' starts a comment. Patterns use '+' for empty cells, 'O' for the engine and
+// 'X' for the player, positive values favour the engine. Values are kept as
+// they are tuned, the trie takes them rounded and limited to kMaxPatternValue.
+class Weights final {
+public:
+    struct Weight {
+        std::string pattern;
+        float value;
+    };
+
+    // Starts with the built in table.
+    Weights();
+
+    std::vector<Weight>& weights() { return weights_; }
+    const std::vector<Weight>& weights() const { return weights_; }
+
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+    // Pattern indices of the trie follow the order of the weights.
+    void Build(Patterns* patterns) const;
+
+    // Returns the shared trie of the weights file, an empty path selects the
+    // built in table. Returns nullptr if the file cannot be loaded.
+    static const Patterns* GetPatterns(const std::string& path);
+
+private:
+    struct Pattern {
+        const char* pattern_;
+        float value_;
+    };
+
+    static const Pattern kPatterns[];
+
+    std::vector<Weight> weights_;
+};
+
+}  // namespace asparagus
+
+#endif  // ASPARAGUS_WEIGHTS_H